@@ -0,0 +1,119 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Goal-directed point-to-point search. The heuristic estimates the remaining weight from
+// a vertex to the target; it must be consistent (never decrease by more than an edge's
+// weight along that edge), which also makes it admissible, so routes stay exact.
+template <typename Weight>
+class AStarRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using Heuristic = std::function<Weight(VertexId vertex, VertexId target)>;
+
+    AStarRouter(const Graph& graph, Heuristic heuristic);
+
+    using RouteInfo = typename Router<Weight>::RouteInfo;
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+private:
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+    static constexpr Weight ZERO_WEIGHT{};
+
+    const Graph& graph_;
+    Heuristic heuristic_;
+};
+
+template <typename Weight>
+AStarRouter<Weight>::AStarRouter(const Graph& graph, Heuristic heuristic)
+    : graph_(graph)
+    , heuristic_(std::move(heuristic))
+{
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename AStarRouter<Weight>::RouteInfo> AStarRouter<Weight>::BuildRoute(VertexId from,
+                                                                                       VertexId to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    std::vector<Weight> weights(vertex_count, ZERO_WEIGHT);
+    std::vector<EdgeId> prev_edges(vertex_count, NO_EDGE);
+    std::vector<bool> settled(vertex_count, false);
+    const auto is_reached = [&](VertexId vertex) {
+        return vertex == from || prev_edges[vertex] != NO_EDGE;
+    };
+    // The heuristic is usually far more expensive than an edge relaxation, so it is
+    // evaluated at most once per vertex: on first reach.
+    std::vector<Weight> estimates(vertex_count, ZERO_WEIGHT);
+
+    using QueueItem = std::pair<Weight, VertexId>;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+    queue.emplace(heuristic_(from, to), from);
+
+    while (!queue.empty()) {
+        const VertexId vertex = queue.top().second;
+        queue.pop();
+        if (settled[vertex]) {
+            continue;
+        }
+        settled[vertex] = true;
+        if (vertex == to) {
+            break;
+        }
+
+        const auto edges = graph_.GetOutgoingEdgeSlice(vertex);
+        for (size_t i = 0; i < edges.size(); ++i) {
+            const VertexId next = edges.vertices[i];
+            if (settled[next]) {
+                continue;
+            }
+            const Weight candidate_weight = weights[vertex] + edges.weights[i];
+            const bool first_reach = !is_reached(next);
+            if (first_reach || candidate_weight < weights[next]) {
+                if (first_reach) {
+                    estimates[next] = heuristic_(next, to);
+                }
+                weights[next] = candidate_weight;
+                prev_edges[next] = edges.edge_ids[i];
+                queue.emplace(candidate_weight + estimates[next], next);
+            }
+        }
+    }
+
+    if (!settled[to]) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> edges;
+    for (VertexId vertex = to; vertex != from; vertex = graph_.GetEdge(prev_edges[vertex]).from) {
+        edges.push_back(prev_edges[vertex]);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{weights[to], std::move(edges)};
+}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+namespace transport_catalogue {
+    // 64-bit FNV-1a over a canonical sequence of values. It fingerprints data that persisted
+    // files were built from; it is not meant for hash tables.
+    class ContentHasher {
+    public:
+        template<typename T> requires std::is_trivially_copyable_v<T>
+        void Add(const T &value) {
+            AddBytes(reinterpret_cast<const unsigned char *>(&value), sizeof(T));
+        }
+
+        void Add(std::string_view text) {
+            Add(static_cast<uint64_t>(text.size()));
+            AddBytes(reinterpret_cast<const unsigned char *>(text.data()), text.size());
+        }
+
+        uint64_t GetHash() const {
+            return hash_;
+        }
+
+    private:
+        void AddBytes(const unsigned char *bytes, size_t size) {
+            for (size_t i = 0; i < size; ++i) {
+                hash_ = (hash_ ^ bytes[i]) * 1099511628211ull;
+            }
+        }
+
+        uint64_t hash_ = 14695981039346656037ull;
+    };
+}
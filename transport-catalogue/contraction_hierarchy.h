@@ -0,0 +1,525 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Contraction Hierarchies: vertices are contracted one by one in order of edge difference,
+// adding shortcut arcs wherever no witness path exists. Queries run a bidirectional
+// Dijkstra that only climbs the hierarchy, and shortcuts are unpacked back into the
+// original graph edges, so BuildRoute returns the same kind of edge list as Router.
+template <typename Weight>
+class ContractionHierarchyRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    static constexpr size_t DEFAULT_WITNESS_SETTLE_LIMIT = 64;
+
+    explicit ContractionHierarchyRouter(const Graph& graph,
+                                        size_t witness_settle_limit = DEFAULT_WITNESS_SETTLE_LIMIT);
+
+    using RouteInfo = typename Router<Weight>::RouteInfo;
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    size_t GetShortcutCount() const {
+        return arcs_.size() - graph_.GetEdgeCount();
+    }
+
+private:
+    static constexpr size_t NO_ARC = std::numeric_limits<size_t>::max();
+
+    // Arcs [0, edge count) mirror the graph edges; shortcuts are appended after them and
+    // refer to the two arcs they replace.
+    struct Arc {
+        VertexId from;
+        VertexId to;
+        Weight weight;
+        size_t first_half = NO_ARC;
+        size_t second_half = NO_ARC;
+
+        bool IsShortcut() const {
+            return first_half != NO_ARC;
+        }
+    };
+
+    struct Shortcut {
+        size_t in_arc;
+        size_t out_arc;
+    };
+
+    class Contractor;
+
+    // Dense per-vertex labels that are reset through the list of touched vertices, so a
+    // query costs O(search space) instead of O(V).
+    class SearchLabels {
+    public:
+        explicit SearchLabels(size_t vertex_count)
+            : weights_(vertex_count, ZERO_WEIGHT)
+            , parent_arcs_(vertex_count, NO_ARC)
+            , reached_(vertex_count, false) {
+        }
+
+        bool IsReached(VertexId vertex) const {
+            return reached_[vertex];
+        }
+
+        Weight GetWeight(VertexId vertex) const {
+            return weights_[vertex];
+        }
+
+        size_t GetParentArc(VertexId vertex) const {
+            return parent_arcs_[vertex];
+        }
+
+        bool Improve(VertexId vertex, Weight weight, size_t parent_arc) {
+            if (reached_[vertex] && !(weight < weights_[vertex])) {
+                return false;
+            }
+            if (!reached_[vertex]) {
+                reached_[vertex] = true;
+                touched_.push_back(vertex);
+            }
+            weights_[vertex] = weight;
+            parent_arcs_[vertex] = parent_arc;
+            return true;
+        }
+
+        void Clear() {
+            for (const VertexId vertex : touched_) {
+                reached_[vertex] = false;
+            }
+            touched_.clear();
+        }
+
+    private:
+        std::vector<Weight> weights_;
+        std::vector<size_t> parent_arcs_;
+        std::vector<bool> reached_;
+        std::vector<VertexId> touched_;
+    };
+
+    struct SearchSpace {
+        SearchLabels forward;
+        SearchLabels backward;
+    };
+
+    std::unique_ptr<SearchSpace> AcquireSearchSpace() const;
+
+    void ReleaseSearchSpace(std::unique_ptr<SearchSpace> search_space) const;
+
+    void BuildSearchGraph();
+
+    void UnpackArc(size_t arc_id, std::vector<EdgeId>& edges) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+    std::vector<Arc> arcs_;
+    std::vector<size_t> rank_;
+    std::vector<std::vector<size_t>> upward_out_arcs_;
+    std::vector<std::vector<size_t>> upward_in_arcs_;
+
+    mutable std::mutex search_spaces_mutex_;
+    mutable std::vector<std::unique_ptr<SearchSpace>> free_search_spaces_;
+};
+
+template <typename Weight>
+class ContractionHierarchyRouter<Weight>::Contractor {
+public:
+    Contractor(ContractionHierarchyRouter& router, size_t witness_settle_limit)
+        : router_(router)
+        , witness_settle_limit_(witness_settle_limit)
+        , vertex_count_(router.graph_.GetVertexCount())
+        , out_arcs_(vertex_count_)
+        , in_arcs_(vertex_count_)
+        , contracted_(vertex_count_, false)
+        , contracted_neighbors_(vertex_count_, 0)
+        , witness_weights_(vertex_count_, ZERO_WEIGHT)
+        , witness_reached_(vertex_count_, false)
+        , witness_targets_(vertex_count_, false)
+    {
+        for (size_t arc_id = 0; arc_id < router_.arcs_.size(); ++arc_id) {
+            const Arc& arc = router_.arcs_[arc_id];
+            if (arc.from != arc.to) {
+                out_arcs_[arc.from].push_back(arc_id);
+                in_arcs_[arc.to].push_back(arc_id);
+            }
+        }
+    }
+
+    void Run() {
+        using QueueItem = std::pair<long long, VertexId>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            queue.emplace(ComputePriority(vertex, FindShortcuts(vertex).size()), vertex);
+        }
+
+        size_t next_rank = 0;
+        while (!queue.empty()) {
+            const VertexId vertex = queue.top().second;
+            queue.pop();
+            if (contracted_[vertex]) {
+                continue;
+            }
+            auto shortcuts = FindShortcuts(vertex);
+            const long long priority = ComputePriority(vertex, shortcuts.size());
+            if (!queue.empty() && priority > queue.top().first) {
+                queue.emplace(priority, vertex);
+                continue;
+            }
+            Contract(vertex, shortcuts);
+            router_.rank_[vertex] = next_rank++;
+        }
+    }
+
+private:
+    long long ComputePriority(VertexId vertex, size_t shortcut_count) const {
+        const size_t removed_arc_count = in_arcs_[vertex].size() + out_arcs_[vertex].size();
+        return static_cast<long long>(shortcut_count) - static_cast<long long>(removed_arc_count)
+               + contracted_neighbors_[vertex];
+    }
+
+    // Keeps only the lightest arc to each remaining neighbour.
+    std::vector<size_t> LightestArcs(const std::vector<size_t>& arc_ids, bool by_target) const {
+        std::unordered_map<VertexId, size_t> lightest;
+        for (const size_t arc_id : arc_ids) {
+            const Arc& arc = router_.arcs_[arc_id];
+            const VertexId neighbor = by_target ? arc.to : arc.from;
+            auto [it, inserted] = lightest.emplace(neighbor, arc_id);
+            if (!inserted && arc.weight < router_.arcs_[it->second].weight) {
+                it->second = arc_id;
+            }
+        }
+        std::vector<size_t> result;
+        result.reserve(lightest.size());
+        for (const auto& [neighbor, arc_id] : lightest) {
+            result.push_back(arc_id);
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    std::vector<Shortcut> FindShortcuts(VertexId vertex) {
+        std::vector<Shortcut> shortcuts;
+        const auto in_arcs = LightestArcs(in_arcs_[vertex], false);
+        const auto out_arcs = LightestArcs(out_arcs_[vertex], true);
+        if (in_arcs.empty() || out_arcs.empty()) {
+            return shortcuts;
+        }
+
+        Weight max_out_weight = ZERO_WEIGHT;
+        for (const size_t out_arc : out_arcs) {
+            max_out_weight = std::max(max_out_weight, router_.arcs_[out_arc].weight);
+        }
+
+        for (const size_t in_arc : in_arcs) {
+            const Arc& incoming = router_.arcs_[in_arc];
+            size_t target_count = 0;
+            for (const size_t out_arc : out_arcs) {
+                if (const VertexId target = router_.arcs_[out_arc].to; target != incoming.from) {
+                    witness_targets_[target] = true;
+                    ++target_count;
+                }
+            }
+            RunWitnessSearch(incoming.from, vertex, incoming.weight + max_out_weight, target_count);
+            for (const size_t out_arc : out_arcs) {
+                const Arc& outgoing = router_.arcs_[out_arc];
+                if (outgoing.to == incoming.from) {
+                    continue;
+                }
+                const Weight via_weight = incoming.weight + outgoing.weight;
+                if (!witness_reached_[outgoing.to] || via_weight < witness_weights_[outgoing.to]) {
+                    shortcuts.push_back({in_arc, out_arc});
+                }
+                witness_targets_[outgoing.to] = false;
+            }
+            ResetWitnessSearch();
+        }
+        return shortcuts;
+    }
+
+    // Bounded Dijkstra from source that avoids the vertex being contracted and stops once
+    // every target is settled. Hitting the settle limit only means extra shortcuts, never
+    // wrong distances.
+    void RunWitnessSearch(VertexId source, VertexId excluded, Weight max_weight, size_t target_count) {
+        using QueueItem = std::pair<Weight, VertexId>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+        Reach(source, ZERO_WEIGHT);
+        queue.emplace(ZERO_WEIGHT, source);
+
+        size_t settled_count = 0;
+        while (!queue.empty() && settled_count < witness_settle_limit_) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > witness_weights_[vertex]) {
+                continue;
+            }
+            if (max_weight < weight) {
+                break;
+            }
+            if (witness_targets_[vertex] && --target_count == 0) {
+                break;
+            }
+            ++settled_count;
+            for (const size_t arc_id : out_arcs_[vertex]) {
+                const Arc& arc = router_.arcs_[arc_id];
+                if (arc.to == excluded) {
+                    continue;
+                }
+                const Weight candidate_weight = weight + arc.weight;
+                if (!witness_reached_[arc.to] || candidate_weight < witness_weights_[arc.to]) {
+                    Reach(arc.to, candidate_weight);
+                    queue.emplace(candidate_weight, arc.to);
+                }
+            }
+        }
+    }
+
+    void Reach(VertexId vertex, Weight weight) {
+        if (!witness_reached_[vertex]) {
+            witness_reached_[vertex] = true;
+            witness_touched_.push_back(vertex);
+        }
+        witness_weights_[vertex] = weight;
+    }
+
+    void ResetWitnessSearch() {
+        for (const VertexId vertex : witness_touched_) {
+            witness_reached_[vertex] = false;
+        }
+        witness_touched_.clear();
+    }
+
+    void Contract(VertexId vertex, const std::vector<Shortcut>& shortcuts) {
+        for (const Shortcut& shortcut : shortcuts) {
+            const VertexId shortcut_from = router_.arcs_[shortcut.in_arc].from;
+            const VertexId shortcut_to = router_.arcs_[shortcut.out_arc].to;
+            const Weight shortcut_weight = router_.arcs_[shortcut.in_arc].weight + router_.arcs_[shortcut.out_arc].weight;
+            const size_t arc_id = router_.arcs_.size();
+            router_.arcs_.push_back(Arc{shortcut_from, shortcut_to, shortcut_weight, shortcut.in_arc, shortcut.out_arc});
+            out_arcs_[shortcut_from].push_back(arc_id);
+            in_arcs_[shortcut_to].push_back(arc_id);
+        }
+
+        const auto detach = [this, vertex](std::vector<size_t>& arc_ids) {
+            arc_ids.erase(std::remove_if(arc_ids.begin(), arc_ids.end(), [this, vertex](size_t arc_id) {
+                const Arc& arc = router_.arcs_[arc_id];
+                return arc.from == vertex || arc.to == vertex;
+            }), arc_ids.end());
+        };
+        for (const size_t arc_id : in_arcs_[vertex]) {
+            const VertexId neighbor = router_.arcs_[arc_id].from;
+            detach(out_arcs_[neighbor]);
+            ++contracted_neighbors_[neighbor];
+        }
+        for (const size_t arc_id : out_arcs_[vertex]) {
+            const VertexId neighbor = router_.arcs_[arc_id].to;
+            detach(in_arcs_[neighbor]);
+            ++contracted_neighbors_[neighbor];
+        }
+        in_arcs_[vertex].clear();
+        out_arcs_[vertex].clear();
+        contracted_[vertex] = true;
+    }
+
+    ContractionHierarchyRouter& router_;
+    size_t witness_settle_limit_;
+    size_t vertex_count_;
+    std::vector<std::vector<size_t>> out_arcs_;
+    std::vector<std::vector<size_t>> in_arcs_;
+    std::vector<bool> contracted_;
+    std::vector<long long> contracted_neighbors_;
+
+    std::vector<Weight> witness_weights_;
+    std::vector<bool> witness_reached_;
+    std::vector<bool> witness_targets_;
+    std::vector<VertexId> witness_touched_;
+};
+
+template <typename Weight>
+ContractionHierarchyRouter<Weight>::ContractionHierarchyRouter(const Graph& graph, size_t witness_settle_limit)
+    : graph_(graph)
+    , rank_(graph.GetVertexCount(), 0)
+    , upward_out_arcs_(graph.GetVertexCount())
+    , upward_in_arcs_(graph.GetVertexCount())
+{
+    arcs_.reserve(graph.GetEdgeCount());
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        const auto& edge = graph.GetEdge(edge_id);
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        // A removed edge keeps its arc id as a self-loop, which both wiring passes skip.
+        const VertexId to = graph.IsEdgeRemoved(edge_id) ? edge.from : edge.to;
+        arcs_.push_back(Arc{edge.from, to, edge.weight});
+    }
+
+    Contractor(*this, witness_settle_limit).Run();
+    BuildSearchGraph();
+}
+
+template <typename Weight>
+void ContractionHierarchyRouter<Weight>::BuildSearchGraph() {
+    for (size_t arc_id = 0; arc_id < arcs_.size(); ++arc_id) {
+        const Arc& arc = arcs_[arc_id];
+        if (arc.from == arc.to) {
+            continue;
+        }
+        if (rank_[arc.from] < rank_[arc.to]) {
+            upward_out_arcs_[arc.from].push_back(arc_id);
+        } else {
+            upward_in_arcs_[arc.to].push_back(arc_id);
+        }
+    }
+}
+
+template <typename Weight>
+std::unique_ptr<typename ContractionHierarchyRouter<Weight>::SearchSpace>
+ContractionHierarchyRouter<Weight>::AcquireSearchSpace() const {
+    {
+        std::lock_guard guard(search_spaces_mutex_);
+        if (!free_search_spaces_.empty()) {
+            auto search_space = std::move(free_search_spaces_.back());
+            free_search_spaces_.pop_back();
+            return search_space;
+        }
+    }
+    const size_t vertex_count = graph_.GetVertexCount();
+    return std::make_unique<SearchSpace>(SearchSpace{SearchLabels(vertex_count), SearchLabels(vertex_count)});
+}
+
+template <typename Weight>
+void ContractionHierarchyRouter<Weight>::ReleaseSearchSpace(std::unique_ptr<SearchSpace> search_space) const {
+    search_space->forward.Clear();
+    search_space->backward.Clear();
+    std::lock_guard guard(search_spaces_mutex_);
+    free_search_spaces_.push_back(std::move(search_space));
+}
+
+template <typename Weight>
+void ContractionHierarchyRouter<Weight>::UnpackArc(size_t arc_id, std::vector<EdgeId>& edges) const {
+    std::vector<size_t> stack{arc_id};
+    while (!stack.empty()) {
+        const size_t current = stack.back();
+        const Arc& arc = arcs_[current];
+        stack.pop_back();
+        if (arc.IsShortcut()) {
+            stack.push_back(arc.second_half);
+            stack.push_back(arc.first_half);
+        } else {
+            edges.push_back(current);
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename ContractionHierarchyRouter<Weight>::RouteInfo>
+ContractionHierarchyRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    if (from == to) {
+        return RouteInfo{ZERO_WEIGHT, {}};
+    }
+
+    using QueueItem = std::pair<Weight, VertexId>;
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>>;
+    auto search_space = AcquireSearchSpace();
+    SearchLabels& forward_labels = search_space->forward;
+    SearchLabels& backward_labels = search_space->backward;
+    forward_labels.Improve(from, ZERO_WEIGHT, NO_ARC);
+    backward_labels.Improve(to, ZERO_WEIGHT, NO_ARC);
+    Queue forward_queue;
+    Queue backward_queue;
+    forward_queue.emplace(ZERO_WEIGHT, from);
+    backward_queue.emplace(ZERO_WEIGHT, to);
+
+    std::optional<Weight> best_weight;
+    VertexId meeting_vertex = from;
+
+    const auto step = [&](Queue& queue, SearchLabels& labels, const SearchLabels& other_labels, bool forward) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (weight > labels.GetWeight(vertex)) {
+            return;
+        }
+        if (best_weight && !(weight < *best_weight)) {
+            queue = Queue{};
+            return;
+        }
+        if (other_labels.IsReached(vertex)) {
+            const Weight total_weight = weight + other_labels.GetWeight(vertex);
+            if (!best_weight || total_weight < *best_weight) {
+                best_weight = total_weight;
+                meeting_vertex = vertex;
+            }
+        }
+        // Stall-on-demand: a higher vertex already offers a shorter way here, so this
+        // label is not a shortest-path one and need not be expanded.
+        for (const size_t arc_id : forward ? upward_in_arcs_[vertex] : upward_out_arcs_[vertex]) {
+            const Arc& arc = arcs_[arc_id];
+            const VertexId higher = forward ? arc.from : arc.to;
+            if (labels.IsReached(higher) && labels.GetWeight(higher) + arc.weight < weight) {
+                return;
+            }
+        }
+        for (const size_t arc_id : forward ? upward_out_arcs_[vertex] : upward_in_arcs_[vertex]) {
+            const Arc& arc = arcs_[arc_id];
+            const VertexId next = forward ? arc.to : arc.from;
+            const Weight candidate_weight = weight + arc.weight;
+            if (labels.Improve(next, candidate_weight, arc_id)) {
+                queue.emplace(candidate_weight, next);
+            }
+        }
+    };
+
+    while (!forward_queue.empty() || !backward_queue.empty()) {
+        const bool forward_turn = backward_queue.empty()
+            || (!forward_queue.empty() && !(backward_queue.top().first < forward_queue.top().first));
+        if (forward_turn) {
+            step(forward_queue, forward_labels, backward_labels, true);
+        } else {
+            step(backward_queue, backward_labels, forward_labels, false);
+        }
+    }
+
+    std::vector<EdgeId> edges;
+    if (best_weight) {
+        std::vector<size_t> forward_arcs;
+        for (VertexId vertex = meeting_vertex; vertex != from;) {
+            const size_t arc_id = forward_labels.GetParentArc(vertex);
+            forward_arcs.push_back(arc_id);
+            vertex = arcs_[arc_id].from;
+        }
+        for (auto it = forward_arcs.rbegin(); it != forward_arcs.rend(); ++it) {
+            UnpackArc(*it, edges);
+        }
+        for (VertexId vertex = meeting_vertex; vertex != to;) {
+            const size_t arc_id = backward_labels.GetParentArc(vertex);
+            UnpackArc(arc_id, edges);
+            vertex = arcs_[arc_id].to;
+        }
+    }
+    ReleaseSearchSpace(std::move(search_space));
+
+    if (!best_weight) {
+        return std::nullopt;
+    }
+    return RouteInfo{*best_weight, std::move(edges)};
+}
+
+}
@@ -0,0 +1,362 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Answers BuildRoute on demand with Dijkstra searches instead of an all-pairs table.
+// Shortest-path trees are kept in an LRU cache keyed by source vertex, so memory is
+// O(E + cache_capacity * V) rather than O(V^2).
+template <typename Weight>
+class DijkstraRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    static constexpr size_t DEFAULT_CACHE_CAPACITY = 64;
+
+    explicit DijkstraRouter(const Graph& graph, size_t cache_capacity = DEFAULT_CACHE_CAPACITY);
+
+    using RouteInfo = typename Router<Weight>::RouteInfo;
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    // Drops all cached trees; call it after the graph has changed.
+    void ClearCache() {
+        std::lock_guard guard(cache_mutex_);
+        cache_.clear();
+        lru_order_.clear();
+    }
+
+private:
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+    struct ShortestPathTree {
+        std::vector<Weight> weights;
+        std::vector<EdgeId> prev_edges;
+
+        bool IsReached(VertexId source, VertexId vertex) const {
+            return vertex == source || prev_edges[vertex] != NO_EDGE;
+        }
+    };
+
+    struct CacheEntry {
+        std::shared_ptr<const ShortestPathTree> tree;
+        typename std::list<VertexId>::iterator lru_position;
+    };
+
+    ShortestPathTree ComputeTree(VertexId source) const;
+
+    std::shared_ptr<const ShortestPathTree> GetTree(VertexId source) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+    size_t cache_capacity_;
+
+    mutable std::mutex cache_mutex_;
+    mutable std::list<VertexId> lru_order_;
+    mutable std::unordered_map<VertexId, CacheEntry> cache_;
+};
+
+template <typename Weight>
+DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph, size_t cache_capacity)
+    : graph_(graph)
+    , cache_capacity_(std::max<size_t>(cache_capacity, 1))
+{
+    const size_t vertex_count = graph.GetVertexCount();
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+            if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+    }
+}
+
+template <typename Weight>
+typename DijkstraRouter<Weight>::ShortestPathTree DijkstraRouter<Weight>::ComputeTree(VertexId source) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    ShortestPathTree tree{std::vector<Weight>(vertex_count, ZERO_WEIGHT),
+                          std::vector<EdgeId>(vertex_count, NO_EDGE)};
+    std::vector<bool> settled(vertex_count, false);
+
+    using QueueItem = std::pair<Weight, VertexId>;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+    queue.emplace(ZERO_WEIGHT, source);
+
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (settled[vertex]) {
+            continue;
+        }
+        settled[vertex] = true;
+
+        const auto edges = graph_.GetOutgoingEdgeSlice(vertex);
+        for (size_t i = 0; i < edges.size(); ++i) {
+            const VertexId next = edges.vertices[i];
+            if (settled[next]) {
+                continue;
+            }
+            const Weight candidate_weight = weight + edges.weights[i];
+            if (!tree.IsReached(source, next) || candidate_weight < tree.weights[next]) {
+                tree.weights[next] = candidate_weight;
+                tree.prev_edges[next] = edges.edge_ids[i];
+                queue.emplace(candidate_weight, next);
+            }
+        }
+    }
+
+    return tree;
+}
+
+template <typename Weight>
+std::shared_ptr<const typename DijkstraRouter<Weight>::ShortestPathTree>
+DijkstraRouter<Weight>::GetTree(VertexId source) const {
+    {
+        std::lock_guard guard(cache_mutex_);
+        if (auto it = cache_.find(source); it != cache_.end()) {
+            lru_order_.splice(lru_order_.begin(), lru_order_, it->second.lru_position);
+            return it->second.tree;
+        }
+    }
+
+    auto tree = std::make_shared<const ShortestPathTree>(ComputeTree(source));
+
+    std::lock_guard guard(cache_mutex_);
+    if (auto it = cache_.find(source); it != cache_.end()) {
+        return it->second.tree;
+    }
+    if (cache_.size() >= cache_capacity_) {
+        cache_.erase(lru_order_.back());
+        lru_order_.pop_back();
+    }
+    lru_order_.push_front(source);
+    cache_.emplace(source, CacheEntry{tree, lru_order_.begin()});
+    return tree;
+}
+
+template <typename Weight>
+std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRoute(VertexId from,
+                                                                                             VertexId to) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    const auto tree = GetTree(from);
+    if (!tree->IsReached(from, to)) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> edges;
+    for (VertexId vertex = to; vertex != from; vertex = graph_.GetEdge(tree->prev_edges[vertex]).from) {
+        edges.push_back(tree->prev_edges[vertex]);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{tree->weights[to], std::move(edges)};
+}
+
+// Point-to-point Dijkstra that alternates a forward search from the source with a backward
+// search from the target over the incoming edges, so the graph must be frozen with them.
+// It stops as soon as the two frontier minima together cannot beat the best meeting found
+// so far.
+template <typename Weight>
+class BidirectionalDijkstraRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    explicit BidirectionalDijkstraRouter(const Graph& graph);
+
+    using RouteInfo = typename Router<Weight>::RouteInfo;
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+private:
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+    static constexpr Weight ZERO_WEIGHT{};
+
+    struct Search {
+        Search(VertexId origin, size_t vertex_count)
+            : origin(origin)
+            , weights(vertex_count, ZERO_WEIGHT)
+            , prev_edges(vertex_count, NO_EDGE)
+            , settled(vertex_count, false) {
+            queue.emplace(ZERO_WEIGHT, origin);
+        }
+
+        bool IsReached(VertexId vertex) const {
+            return vertex == origin || prev_edges[vertex] != NO_EDGE;
+        }
+
+        using QueueItem = std::pair<Weight, VertexId>;
+
+        VertexId origin;
+        std::vector<Weight> weights;
+        std::vector<EdgeId> prev_edges;
+        std::vector<bool> settled;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+    };
+
+    const Graph& graph_;
+};
+
+template <typename Weight>
+BidirectionalDijkstraRouter<Weight>::BidirectionalDijkstraRouter(const Graph& graph)
+    : graph_(graph)
+{
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename BidirectionalDijkstraRouter<Weight>::RouteInfo>
+BidirectionalDijkstraRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    if (from == to) {
+        return RouteInfo{ZERO_WEIGHT, {}};
+    }
+
+    Search forward(from, vertex_count);
+    Search backward(to, vertex_count);
+    std::optional<Weight> best_weight;
+    VertexId meeting_vertex = from;
+
+    const auto step = [&](Search& search, const Search& other, bool is_forward) {
+        const auto [weight, vertex] = search.queue.top();
+        search.queue.pop();
+        if (search.settled[vertex]) {
+            return;
+        }
+        search.settled[vertex] = true;
+
+        const auto edges = is_forward ? graph_.GetOutgoingEdgeSlice(vertex) : graph_.GetIncomingEdgeSlice(vertex);
+        for (size_t i = 0; i < edges.size(); ++i) {
+            const VertexId next = edges.vertices[i];
+            if (search.settled[next]) {
+                continue;
+            }
+            const Weight candidate_weight = weight + edges.weights[i];
+            if (search.IsReached(next) && !(candidate_weight < search.weights[next])) {
+                continue;
+            }
+            search.weights[next] = candidate_weight;
+            search.prev_edges[next] = edges.edge_ids[i];
+            search.queue.emplace(candidate_weight, next);
+            if (other.IsReached(next)) {
+                const Weight total_weight = candidate_weight + other.weights[next];
+                if (!best_weight || total_weight < *best_weight) {
+                    best_weight = total_weight;
+                    meeting_vertex = next;
+                }
+            }
+        }
+    };
+
+    bool forward_turn = true;
+    while (!forward.queue.empty() && !backward.queue.empty()) {
+        if (best_weight && !(forward.queue.top().first + backward.queue.top().first < *best_weight)) {
+            break;
+        }
+        if (forward_turn) {
+            step(forward, backward, true);
+        } else {
+            step(backward, forward, false);
+        }
+        forward_turn = !forward_turn;
+    }
+
+    if (!best_weight) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> edges;
+    for (VertexId vertex = meeting_vertex; vertex != from; vertex = graph_.GetEdge(forward.prev_edges[vertex]).from) {
+        edges.push_back(forward.prev_edges[vertex]);
+    }
+    std::reverse(edges.begin(), edges.end());
+    for (VertexId vertex = meeting_vertex; vertex != to; vertex = graph_.GetEdge(backward.prev_edges[vertex]).to) {
+        edges.push_back(backward.prev_edges[vertex]);
+    }
+
+    return RouteInfo{*best_weight, std::move(edges)};
+}
+
+// One-to-many Dijkstra: weights of the shortest paths from source to each of targets
+// (std::nullopt for unreachable ones). The search stops once every target is settled and
+// keeps no predecessor data, so it is the cheap building block for travel-time matrices.
+template <typename Weight>
+std::vector<std::optional<Weight>> BuildWeightsToTargets(const DirectedWeightedGraph<Weight>& graph,
+                                                         VertexId source, const std::vector<VertexId>& targets) {
+    const size_t vertex_count = graph.GetVertexCount();
+    if (source >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    constexpr Weight zero_weight{};
+    std::vector<std::optional<Weight>> weights(vertex_count);
+    std::vector<bool> settled(vertex_count, false);
+    std::vector<bool> is_target(vertex_count, false);
+    size_t targets_left = 0;
+    for (const VertexId target : targets) {
+        if (!is_target.at(target)) {
+            is_target[target] = true;
+            ++targets_left;
+        }
+    }
+
+    using QueueItem = std::pair<Weight, VertexId>;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+    weights[source] = zero_weight;
+    queue.emplace(zero_weight, source);
+
+    while (!queue.empty() && targets_left > 0) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (settled[vertex]) {
+            continue;
+        }
+        settled[vertex] = true;
+        if (is_target[vertex]) {
+            --targets_left;
+        }
+
+        const auto edges = graph.GetOutgoingEdgeSlice(vertex);
+        for (size_t i = 0; i < edges.size(); ++i) {
+            const VertexId next = edges.vertices[i];
+            const Weight candidate_weight = weight + edges.weights[i];
+            if (!settled[next] && (!weights[next] || candidate_weight < *weights[next])) {
+                weights[next] = candidate_weight;
+                queue.emplace(candidate_weight, next);
+            }
+        }
+    }
+
+    std::vector<std::optional<Weight>> result;
+    result.reserve(targets.size());
+    for (const VertexId target : targets) {
+        result.push_back(settled[target] ? weights[target] : std::nullopt);
+    }
+    return result;
+}
+
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "domain.h"
+
+namespace transport_catalogue {
+    // Road distances between stops in an open-addressing table with linear probing, keyed by
+    // the packed (from, to) stop ids. Setting a distance also stores it for the reverse
+    // direction unless that one is set explicitly, so a lookup is a single probe sequence.
+    class DistanceTable {
+    public:
+        void Set(domain::StopId from, domain::StopId to, int distance) {
+            Insert(GetKey(from, to), distance, false);
+            const Slot &reverse = slots_[FindSlot(GetKey(to, from))];
+            if (reverse.key == EMPTY_KEY || reverse.is_derived) {
+                Insert(GetKey(to, from), distance, true);
+            }
+        }
+
+        std::optional<int> Find(domain::StopId from, domain::StopId to) const {
+            if (slots_.empty()) {
+                return std::nullopt;
+            }
+            const Slot &slot = slots_[FindSlot(GetKey(from, to))];
+            return slot.key != EMPTY_KEY ? std::optional(slot.distance) : std::nullopt;
+        }
+
+        // Visits the distances that were set explicitly, in no particular order.
+        template<typename Visitor>
+        void ForEachExplicit(Visitor visitor) const {
+            for (const Slot &slot: slots_) {
+                if (slot.key != EMPTY_KEY && !slot.is_derived) {
+                    visitor(static_cast<domain::StopId>(slot.key >> 32), static_cast<domain::StopId>(slot.key),
+                            slot.distance);
+                }
+            }
+        }
+
+        size_t GetExplicitCount() const {
+            return explicit_count_;
+        }
+
+    private:
+        struct Slot {
+            uint64_t key;
+            int distance;
+            bool is_derived;
+        };
+
+        // Stop ids stay below the 32-bit maximum, so no real pair packs to this key.
+        static constexpr uint64_t EMPTY_KEY = std::numeric_limits<uint64_t>::max();
+        static constexpr size_t MIN_CAPACITY = 16;
+
+        static uint64_t GetKey(domain::StopId from, domain::StopId to) {
+            return static_cast<uint64_t>(from) << 32 | to;
+        }
+
+        // The 64-bit finalizer of MurmurHash3: every key bit affects every slot index bit, so
+        // ids that differ only in their high or low half still spread over the table.
+        static uint64_t Mix(uint64_t key) {
+            key ^= key >> 33;
+            key *= 0xff51afd7ed558ccdULL;
+            key ^= key >> 33;
+            key *= 0xc4ceb9fe1a85ec53ULL;
+            key ^= key >> 33;
+            return key;
+        }
+
+        // The slot holding key, or the empty slot where it would be inserted.
+        size_t FindSlot(uint64_t key) const {
+            const size_t mask = slots_.size() - 1;
+            size_t index = Mix(key) & mask;
+            while (slots_[index].key != key && slots_[index].key != EMPTY_KEY) {
+                index = (index + 1) & mask;
+            }
+            return index;
+        }
+
+        void Insert(uint64_t key, int distance, bool is_derived) {
+            // At most half full, which keeps probe sequences short.
+            if ((size_ + 1) * 2 > slots_.size()) {
+                Rehash(std::max(MIN_CAPACITY, slots_.size() * 2));
+            }
+            Slot &slot = slots_[FindSlot(key)];
+            if (slot.key == EMPTY_KEY) {
+                slot.key = key;
+                ++size_;
+            } else if (!slot.is_derived) {
+                --explicit_count_;
+            }
+            slot.distance = distance;
+            slot.is_derived = is_derived;
+            if (!is_derived) {
+                ++explicit_count_;
+            }
+        }
+
+        void Rehash(size_t capacity) {
+            std::vector<Slot> old_slots(capacity, Slot{EMPTY_KEY, 0, false});
+            old_slots.swap(slots_);
+            for (const Slot &slot: old_slots) {
+                if (slot.key != EMPTY_KEY) {
+                    slots_[FindSlot(slot.key)] = slot;
+                }
+            }
+        }
+
+        std::vector<Slot> slots_;
+        size_t size_ = 0;
+        size_t explicit_count_ = 0;
+    };
+}
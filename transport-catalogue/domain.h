@@ -1,19 +1,11 @@
 #pragma once
+#include <cstdint>
 #include <string_view>
-#include <vector>
-#include "geo.h"
 
 namespace domain {
-    struct Stop {
-        std::string_view name;
-        transport_catalogue::geo::Coordinates coordinates;
-    };
-
-    struct Bus {
-        std::string_view name;
-        std::vector<const Stop *> stops;
-        bool is_roundtrip = false;
-    };
+    // Dense indices into the catalogue's columns, assigned in insertion order.
+    using StopId = uint32_t;
+    using BusId = uint32_t;
 
     struct BusInfo {
         std::string_view name;
@@ -0,0 +1,30 @@
+#include "geo.h"
+
+#include <cassert>
+
+namespace transport_catalogue::geo {
+    void ComputeSegmentDistances(std::span<const TrigCoordinates> points, std::span<double> distances) {
+        const size_t count = points.size() < 2 ? 0 : points.size() - 1;
+        assert(distances.size() >= count);
+        // Two passes: the first one is plain arithmetic without branches, which the compiler
+        // can turn into SIMD code; only the acos of the second pass stays scalar, as the
+        // standard library has no vector form of it. The cosine is clamped against rounding
+        // just outside [-1, 1].
+        for (size_t i = 0; i < count; ++i) {
+            const TrigCoordinates &from = points[i];
+            const TrigCoordinates &to = points[i + 1];
+            const double cos_lng_delta = from.cos_lng * to.cos_lng + from.sin_lng * to.sin_lng;
+            const double cosine = from.sin_lat * to.sin_lat + from.cos_lat * to.cos_lat * cos_lng_delta;
+            distances[i] = std::fmin(std::fmax(cosine, -1.0), 1.0);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            distances[i] = points[i].coordinates == points[i + 1].coordinates
+                               ? 0.0
+                               : std::acos(distances[i]) * EARTH_RADIUS;
+            // Debug builds check every segment against the scalar formula.
+            assert(std::abs(distances[i] - ComputeDistance(points[i], points[i + 1]))
+                   <= SEGMENT_DISTANCE_ABSOLUTE_TOLERANCE
+                      + SEGMENT_DISTANCE_RELATIVE_TOLERANCE * distances[i]);
+        }
+    }
+}
@@ -1,8 +1,12 @@
 #pragma once
 
 #include <cmath>
+#include <span>
 
 namespace transport_catalogue::geo {
+    inline constexpr double DEGREES_TO_RADIANS = 3.1415926535 / 180.;
+    inline constexpr double EARTH_RADIUS = 6371000;
+
     struct Coordinates {
         double lat;
         double lng;
@@ -21,9 +25,51 @@ namespace transport_catalogue::geo {
         if (from == to) {
             return 0;
         }
-        static constexpr double dr = 3.1415926535 / 180.;
+        static constexpr double dr = DEGREES_TO_RADIANS;
         return acos(sin(from.lat * dr) * sin(to.lat * dr)
                     + cos(from.lat * dr) * cos(to.lat * dr) * cos(abs(from.lng - to.lng) * dr))
-               * 6371000;
+               * EARTH_RADIUS;
+    }
+
+    // A point with the sines and cosines of its latitude and longitude computed once. The
+    // distance between two such points then needs the cosine of the longitude difference
+    // and the acos at most.
+    struct TrigCoordinates {
+        Coordinates coordinates;
+        double sin_lat;
+        double cos_lat;
+        double sin_lng;
+        double cos_lng;
+    };
+
+    inline TrigCoordinates ToTrigCoordinates(const Coordinates coordinates) {
+        const double lat = coordinates.lat * DEGREES_TO_RADIANS;
+        const double lng = coordinates.lng * DEGREES_TO_RADIANS;
+        return {coordinates, std::sin(lat), std::cos(lat), std::sin(lng), std::cos(lng)};
+    }
+
+    // Bit-identical to ComputeDistance for the original coordinates: the same terms are
+    // combined in the same order.
+    inline double ComputeDistance(const TrigCoordinates &from, const TrigCoordinates &to) {
+        using namespace std;
+        if (from.coordinates == to.coordinates) {
+            return 0;
+        }
+        static constexpr double dr = DEGREES_TO_RADIANS;
+        return acos(from.sin_lat * to.sin_lat
+                    + from.cos_lat * to.cos_lat * cos(abs(from.coordinates.lng - to.coordinates.lng) * dr))
+               * EARTH_RADIUS;
     }
+
+    // How far a distance from ComputeSegmentDistances may be from ComputeDistance: an
+    // absolute part for near points, where acos is ill-conditioned in both forms, and a
+    // relative part for the rest. Equal points are exactly 0 apart in both.
+    inline constexpr double SEGMENT_DISTANCE_ABSOLUTE_TOLERANCE = 0.5;
+    inline constexpr double SEGMENT_DISTANCE_RELATIVE_TOLERANCE = 1e-8;
+
+    // distances[i] is the distance from points[i] to points[i + 1], within the tolerance
+    // above; distances must hold points.size() - 1 values. The cosine of the longitude
+    // difference is expanded into cos * cos + sin * sin, so the only trigonometry left is
+    // the acos.
+    void ComputeSegmentDistances(std::span<const TrigCoordinates> points, std::span<double> distances);
 }
@@ -1,12 +1,20 @@
 #pragma once
+#include <cstdint>
+#include <limits>
+#include <type_traits>
 #include <vector>
-#include <string>
+#include <span>
 #include <optional>
 #include <stdexcept>
 
+#include "ranges.h"
+
 namespace graph {
     using VertexId = size_t;
     using EdgeId = size_t;
+    using BusId = uint32_t;
+
+    inline constexpr BusId NO_BUS = std::numeric_limits<BusId>::max();
 
     template<typename Weight>
     struct Edge {
@@ -14,43 +22,186 @@ namespace graph {
         VertexId to;
         Weight weight;
 
-
-        std::string bus_name;
+        // The bus ridden along the edge (NO_BUS for waiting at a stop) and the number of
+        // stops it passes. Names are resolved by the owner of the graph.
+        BusId bus_id = NO_BUS;
         int span_count = 0;
     };
 
+    static_assert(std::is_trivially_copyable_v<Edge<double> >);
+
+    // The edges of one vertex in a frozen graph as parallel contiguous arrays: edge ids, the
+    // vertices at the other end (targets for outgoing edges, sources for incoming ones) and
+    // the weights. Traversals read them sequentially instead of going through GetEdge.
+    template<typename Weight>
+    struct EdgeSlice {
+        std::span<const EdgeId> edge_ids;
+        std::span<const VertexId> vertices;
+        std::span<const Weight> weights;
+
+        size_t size() const {
+            return edge_ids.size();
+        }
+    };
+
+    // Built by appending edges, then frozen into compressed sparse rows (edges grouped by
+    // source in insertion order) before it is traversed. Rows grouped by target are built only
+    // when Freeze is asked for them, since only backward searches read them. Edge ids are
+    // insertion indices and never change. Any modification unfreezes the graph until the
+    // next Freeze.
     template<typename Weight>
     class DirectedWeightedGraph {
     public:
         VertexId AddVertex() {
-            adjacency_list_.emplace_back();
-            return adjacency_list_.size() - 1;
+            frozen_ = false;
+            return vertex_count_++;
         }
 
         void Resize(size_t vertex_count) {
-            adjacency_list_.resize(vertex_count);
+            frozen_ = false;
+            vertex_count_ = vertex_count;
         }
 
         EdgeId AddEdge(const Edge<Weight> &edge) {
+            if (edge.from >= vertex_count_ || edge.to >= vertex_count_) {
+                throw std::out_of_range("Edge endpoint is out of range");
+            }
+            frozen_ = false;
             edges_.push_back(edge);
-            adjacency_list_[edge.from].push_back(edges_.size() - 1);
+            removed_edges_.push_back(false);
             return edges_.size() - 1;
         }
 
+        // Excludes the edge from traversal. Its id stays reserved, so the ids of the other
+        // edges, and routing tables that refer to them, remain valid.
+        void RemoveEdge(EdgeId id) {
+            if (removed_edges_.at(id)) {
+                return;
+            }
+            frozen_ = false;
+            removed_edges_[id] = true;
+        }
+
+        bool IsEdgeRemoved(EdgeId id) const {
+            return removed_edges_.at(id);
+        }
+
+        void SetEdgeWeight(EdgeId id, Weight weight) {
+            frozen_ = false;
+            edges_.at(id).weight = weight;
+        }
+
+        // Counting sort of the live edges by source and by target: O(V + E) time and no
+        // per-vertex allocations, so it scales to the millions of edges long routes produce.
+        void Freeze(bool with_incoming_edges = false) {
+            FillRows(outgoing_, [](const Edge<Weight> &edge) { return edge.from; },
+                     [](const Edge<Weight> &edge) { return edge.to; });
+            if (with_incoming_edges) {
+                FillRows(incoming_, [](const Edge<Weight> &edge) { return edge.to; },
+                         [](const Edge<Weight> &edge) { return edge.from; });
+            } else {
+                incoming_ = CompressedRows();
+            }
+            has_incoming_edges_ = with_incoming_edges;
+            frozen_ = true;
+        }
+
+        bool IsFrozen() const {
+            return frozen_;
+        }
+
         const Edge<Weight> &GetEdge(EdgeId id) const {
             return edges_.at(id);
         }
 
-        const std::vector<EdgeId> &GetIncidentEdges(VertexId v) const {
-            return adjacency_list_.at(v);
+        ranges::Range<const EdgeId *> GetIncidentEdges(VertexId v) const {
+            return AsEdgeIdRange(GetOutgoingEdgeSlice(v));
+        }
+
+        ranges::Range<const EdgeId *> GetIncomingEdges(VertexId v) const {
+            return AsEdgeIdRange(GetIncomingEdgeSlice(v));
+        }
+
+        EdgeSlice<Weight> GetOutgoingEdgeSlice(VertexId v) const {
+            return GetSlice(outgoing_, v);
+        }
+
+        EdgeSlice<Weight> GetIncomingEdgeSlice(VertexId v) const {
+            if (!has_incoming_edges_) {
+                throw std::logic_error("Graph was frozen without incoming edges");
+            }
+            return GetSlice(incoming_, v);
         }
 
         size_t GetVertexCount() const {
-            return adjacency_list_.size();
+            return vertex_count_;
+        }
+
+        size_t GetEdgeCount() const {
+            return edges_.size();
         }
 
     private:
+        struct CompressedRows {
+            std::vector<size_t> offsets;
+            std::vector<EdgeId> edge_ids;
+            std::vector<VertexId> vertices;
+            std::vector<Weight> weights;
+        };
+
+        template<typename RowOf, typename ColumnOf>
+        void FillRows(CompressedRows &rows, RowOf row_of, ColumnOf column_of) const {
+            rows.offsets.assign(vertex_count_ + 1, 0);
+            for (EdgeId id = 0; id < edges_.size(); ++id) {
+                if (!removed_edges_[id]) {
+                    ++rows.offsets[row_of(edges_[id]) + 1];
+                }
+            }
+            for (VertexId v = 0; v < vertex_count_; ++v) {
+                rows.offsets[v + 1] += rows.offsets[v];
+            }
+
+            const size_t live_edge_count = rows.offsets.back();
+            rows.edge_ids.resize(live_edge_count);
+            rows.vertices.resize(live_edge_count);
+            rows.weights.resize(live_edge_count);
+            std::vector<size_t> next_positions(rows.offsets.begin(), rows.offsets.end() - 1);
+            for (EdgeId id = 0; id < edges_.size(); ++id) {
+                if (removed_edges_[id]) {
+                    continue;
+                }
+                const Edge<Weight> &edge = edges_[id];
+                const size_t position = next_positions[row_of(edge)]++;
+                rows.edge_ids[position] = id;
+                rows.vertices[position] = column_of(edge);
+                rows.weights[position] = edge.weight;
+            }
+        }
+
+        EdgeSlice<Weight> GetSlice(const CompressedRows &rows, VertexId v) const {
+            if (!frozen_) {
+                throw std::logic_error("Graph must be frozen before traversal");
+            }
+            if (v >= vertex_count_) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+            const size_t begin = rows.offsets[v];
+            const size_t size = rows.offsets[v + 1] - begin;
+            return {{rows.edge_ids.data() + begin, size},
+                    {rows.vertices.data() + begin, size},
+                    {rows.weights.data() + begin, size}};
+        }
+
+        static ranges::Range<const EdgeId *> AsEdgeIdRange(const EdgeSlice<Weight> &slice) {
+            return {slice.edge_ids.data(), slice.edge_ids.data() + slice.size()};
+        }
+
+        size_t vertex_count_ = 0;
         std::vector<Edge<Weight> > edges_;
-        std::vector<std::vector<EdgeId> > adjacency_list_;
+        std::vector<bool> removed_edges_;
+        bool frozen_ = false;
+        bool has_incoming_edges_ = false;
+        CompressedRows outgoing_;
+        CompressedRows incoming_;
     };
 }
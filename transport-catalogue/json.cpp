@@ -1,80 +1,282 @@
 #include "json.h"
 
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
 #include <iterator>
+#include <span>
+#include <system_error>
+#include <type_traits>
+#include <unordered_set>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace json {
     namespace {
         using namespace std::literals;
 
-        Node LoadNode(std::istream &input);
+        bool IsSpace(char c) {
+            return c == ' ' || (c >= '\t' && c <= '\r');
+        }
 
-        Node LoadString(std::istream &input);
+        bool IsDigit(char c) {
+            return c >= '0' && c <= '9';
+        }
 
-        std::string LoadLiteral(std::istream &input) {
-            std::string s;
-            while (std::isalpha(input.peek())) {
-                s.push_back(static_cast<char>(input.get()));
-            }
-            return s;
+        bool IsAlpha(char c) {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
         }
 
-        Node LoadArray(std::istream &input) {
-            std::vector<Node> result;
+        // Recursive descent over a contiguous buffer. It accepts and rejects exactly what the
+        // original std::istream-based parser did, with the same ParsingError messages: missing
+        // commas are tolerated, a literal is read as a run of letters and only the first value
+        // of the input is parsed.
+        class Parser {
+        public:
+            explicit Parser(std::string_view input)
+                : pos_(input.data())
+                , end_(input.data() + input.size()) {
+            }
 
-            for (char c; input >> c && c != ']';) {
-                if (c != ',') {
-                    input.putback(c);
+            Node LoadNode() {
+                char c;
+                if (!ReadChar(c)) {
+                    throw ParsingError("Unexpected EOF"s);
+                }
+                switch (c) {
+                    case '[':
+                        return LoadArray();
+                    case '{':
+                        return LoadDict();
+                    case '"':
+                        return LoadString();
+                    case 't':
+                        [[fallthrough]];
+                    case 'f':
+                        --pos_;
+                        return LoadBool();
+                    case 'n':
+                        --pos_;
+                        return LoadNull();
+                    default:
+                        --pos_;
+                        return LoadNumber();
                 }
-                result.push_back(LoadNode(input));
             }
-            if (!input) {
-                throw ParsingError("Array parsing error"s);
+
+            // Consumes the opening bracket if the next value is an array.
+            bool TryBeginArray() {
+                return TryBegin('[');
             }
-            return Node(std::move(result));
-        }
 
-        Node LoadDict(std::istream &input) {
-            Dict dict;
+            // Steps over the separator before the next element of an array, or over the
+            // closing bracket, in which case it returns false.
+            bool NextItem() {
+                char c;
+                if (!ReadChar(c)) {
+                    throw ParsingError("Array parsing error"s);
+                }
+                if (c == ']') {
+                    return false;
+                }
+                if (c != ',') {
+                    --pos_;
+                }
+                return true;
+            }
 
-            for (char c; input >> c && c != '}';) {
-                if (c == '"') {
-                    std::string key = LoadString(input).AsString();
-                    if (input >> c && c == ':') {
-                        if (dict.find(key) != dict.end()) {
-                            throw ParsingError("Duplicate key '"s + key + "' have been found");
+            bool TryBeginDict() {
+                return TryBegin('{');
+            }
+
+            // Reads the next key of a dict and the colon after it, or the closing brace, in
+            // which case it returns false.
+            bool NextKey(std::string &key) {
+                char c;
+                while (ReadChar(c)) {
+                    if (c == '}') {
+                        return false;
+                    }
+                    if (c == '"') {
+                        key = ReadString();
+                        // On EOF c keeps the quote, as the failed `input >> c` left it.
+                        if (ReadChar(c) && c == ':') {
+                            return true;
                         }
-                        dict.emplace(std::move(key), LoadNode(input));
-                    } else {
                         throw ParsingError(": is expected but '"s + c + "' has been found"s);
                     }
-                } else if (c != ',') {
-                    throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+                    if (c != ',') {
+                        throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+                    }
                 }
-            }
-            if (!input) {
                 throw ParsingError("Dictionary parsing error"s);
             }
-            return Node(std::move(dict));
-        }
 
-        Node LoadString(std::istream &input) {
-            auto it = std::istreambuf_iterator<char>(input);
-            auto end = std::istreambuf_iterator<char>();
-            std::string s;
-            while (true) {
-                if (it == end) {
-                    throw ParsingError("String parsing error");
-                }
-                const char ch = *it;
-                if (ch == '"') {
-                    ++it;
-                    break;
-                } else if (ch == '\\') {
-                    ++it;
-                    if (it == end) {
+            const char *GetPosition() const {
+                return pos_;
+            }
+
+        private:
+            // Skips whitespace and reads the next character, like `input >> c`.
+            bool ReadChar(char &c) {
+                pos_ = SkipSpaces(pos_, end_);
+                if (pos_ == end_) {
+                    return false;
+                }
+                c = *pos_++;
+                return true;
+            }
+
+            int Peek() const {
+                return pos_ != end_ ? static_cast<unsigned char>(*pos_) : EOF;
+            }
+
+            static const char *SkipSpaces(const char *pos, const char *end) {
+#ifdef __SSE2__
+                // Sixteen bytes at a time while they are all whitespace, which covers the
+                // indentation of pretty-printed input.
+                const __m128i space = _mm_set1_epi8(' ');
+                const __m128i tab = _mm_set1_epi8('\t');
+                const __m128i control_span = _mm_set1_epi8('\r' - '\t');
+                while (end - pos >= 16) {
+                    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pos));
+                    const __m128i offset = _mm_sub_epi8(chunk, tab);
+                    const __m128i is_control = _mm_cmpeq_epi8(_mm_min_epu8(offset, control_span), offset);
+                    const __m128i is_space = _mm_or_si128(_mm_cmpeq_epi8(chunk, space), is_control);
+                    const unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(is_space)) & 0xFFFFu;
+                    if (mask != 0) {
+                        return pos + __builtin_ctz(mask);
+                    }
+                    pos += 16;
+                }
+#endif
+                while (pos != end && IsSpace(*pos)) {
+                    ++pos;
+                }
+                return pos;
+            }
+
+            // The first quote, backslash or line break at or after pos.
+            static const char *FindStringSpecial(const char *pos, const char *end) {
+#ifdef __SSE2__
+                const __m128i quote = _mm_set1_epi8('"');
+                const __m128i backslash = _mm_set1_epi8('\\');
+                const __m128i line_feed = _mm_set1_epi8('\n');
+                const __m128i carriage_return = _mm_set1_epi8('\r');
+                while (end - pos >= 16) {
+                    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pos));
+                    const __m128i special = _mm_or_si128(
+                        _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                        _mm_or_si128(_mm_cmpeq_epi8(chunk, line_feed), _mm_cmpeq_epi8(chunk, carriage_return)));
+                    const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(special));
+                    if (mask != 0) {
+                        return pos + __builtin_ctz(mask);
+                    }
+                    pos += 16;
+                }
+#endif
+                while (pos != end && *pos != '"' && *pos != '\\' && *pos != '\n' && *pos != '\r') {
+                    ++pos;
+                }
+                return pos;
+            }
+
+            std::string LoadLiteral() {
+                const char *begin = pos_;
+                while (pos_ != end_ && IsAlpha(*pos_)) {
+                    ++pos_;
+                }
+                return {begin, pos_};
+            }
+
+            bool TryBegin(char bracket) {
+                pos_ = SkipSpaces(pos_, end_);
+                if (pos_ != end_ && *pos_ == bracket) {
+                    ++pos_;
+                    return true;
+                }
+                return false;
+            }
+
+            // The elements of the arrays and dicts being read are collected on shared stacks
+            // and moved out once a container is closed, so each container gets one
+            // allocation of its exact size.
+            Node LoadArray() {
+                const size_t first = array_stack_.size();
+                while (NextItem()) {
+                    Node node = LoadNode();
+                    array_stack_.push_back(std::move(node));
+                }
+                return Node(Array(PopRange(array_stack_, first)));
+            }
+
+            Node LoadDict() {
+                const size_t first = dict_stack_.size();
+                std::unordered_set<std::string> long_dict_keys;
+                std::string key;
+                while (NextKey(key)) {
+                    if (IsDuplicateKey(first, long_dict_keys, key)) {
+                        throw ParsingError("Duplicate key '"s + key + "' have been found");
+                    }
+                    Node node = LoadNode();
+                    dict_stack_.emplace_back(std::move(key), std::move(node));
+                }
+                return Node(Dict(PopRange(dict_stack_, first)));
+            }
+
+            template<typename T>
+            static std::vector<T> PopRange(std::vector<T> &stack, size_t first) {
+                std::vector<T> result(std::make_move_iterator(stack.begin() + static_cast<std::ptrdiff_t>(first)),
+                                      std::make_move_iterator(stack.end()));
+                stack.resize(first);
+                return result;
+            }
+
+            // A short dict is searched for the key in place; a long one keeps its keys in a hash set.
+            bool IsDuplicateKey(size_t first, std::unordered_set<std::string> &long_dict_keys,
+                                const std::string &key) const {
+                constexpr size_t SHORT_DICT_SIZE = 16;
+                const auto entries = std::span(dict_stack_).subspan(first);
+                if (entries.size() < SHORT_DICT_SIZE) {
+                    return std::any_of(entries.begin(), entries.end(), [&key](const Dict::value_type &entry) {
+                        return entry.first == key;
+                    });
+                }
+                if (long_dict_keys.empty()) {
+                    for (const auto &[entry_key, value]: entries) {
+                        long_dict_keys.insert(entry_key);
+                    }
+                }
+                return !long_dict_keys.insert(key).second;
+            }
+
+            Node LoadString() {
+                return Node(ReadString());
+            }
+
+            std::string ReadString() {
+                std::string s;
+                while (true) {
+                    const char *special = FindStringSpecial(pos_, end_);
+                    s.append(pos_, special);
+                    pos_ = special;
+                    if (pos_ == end_) {
+                        throw ParsingError("String parsing error");
+                    }
+                    const char ch = *pos_++;
+                    if (ch == '"') {
+                        break;
+                    }
+                    if (ch == '\n' || ch == '\r') {
+                        throw ParsingError("Unexpected end of line"s);
+                    }
+                    if (pos_ == end_) {
                         throw ParsingError("String parsing error");
                     }
-                    const char escaped_char = *(it);
+                    const char escaped_char = *pos_++;
                     switch (escaped_char) {
                         case 'n':
                             s.push_back('\n');
@@ -94,122 +296,113 @@ namespace json {
                         default:
                             throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
                     }
-                } else if (ch == '\n' || ch == '\r') {
-                    throw ParsingError("Unexpected end of line"s);
-                } else {
-                    s.push_back(ch);
                 }
-                ++it;
-            }
-
-            return Node(std::move(s));
-        }
 
-        Node LoadBool(std::istream &input) {
-            const auto s = LoadLiteral(input);
-            if (s == "true"sv) {
-                return Node{true};
-            } else if (s == "false"sv) {
-                return Node{false};
-            } else {
-                throw ParsingError("Failed to parse '"s + s + "' as bool"s);
+                return s;
             }
-        }
 
-        Node LoadNull(std::istream &input) {
-            if (auto literal = LoadLiteral(input); literal == "null"sv) {
-                return Node{nullptr};
-            } else {
-                throw ParsingError("Failed to parse '"s + literal + "' as null"s);
+            Node LoadBool() {
+                const auto s = LoadLiteral();
+                if (s == "true"sv) {
+                    return Node{true};
+                } else if (s == "false"sv) {
+                    return Node{false};
+                } else {
+                    throw ParsingError("Failed to parse '"s + s + "' as bool"s);
+                }
             }
-        }
-
-        Node LoadNumber(std::istream &input) {
-            std::string parsed_num;
 
-
-            auto read_char = [&parsed_num, &input] {
-                parsed_num += static_cast<char>(input.get());
-                if (!input) {
-                    throw ParsingError("Failed to read number from stream"s);
+            Node LoadNull() {
+                if (auto literal = LoadLiteral(); literal == "null"sv) {
+                    return Node{nullptr};
+                } else {
+                    throw ParsingError("Failed to parse '"s + literal + "' as null"s);
                 }
-            };
-
+            }
 
-            auto read_digits = [&input, read_char] {
-                if (!std::isdigit(input.peek())) {
+            void ReadDigits() {
+                if (!IsDigit(static_cast<char>(Peek()))) {
                     throw ParsingError("A digit is expected"s);
                 }
-                while (std::isdigit(input.peek())) {
-                    read_char();
+                while (pos_ != end_ && IsDigit(*pos_)) {
+                    ++pos_;
                 }
-            };
-
-            if (input.peek() == '-') {
-                read_char();
             }
 
-            if (input.peek() == '0') {
-                read_char();
-            } else {
-                read_digits();
-            }
+            Node LoadNumber() {
+                const char *begin = pos_;
+                if (Peek() == '-') {
+                    ++pos_;
+                }
 
-            bool is_int = true;
+                if (Peek() == '0') {
+                    ++pos_;
+                } else {
+                    ReadDigits();
+                }
 
-            if (input.peek() == '.') {
-                read_char();
-                read_digits();
-                is_int = false;
-            }
+                bool is_int = true;
 
+                if (Peek() == '.') {
+                    ++pos_;
+                    ReadDigits();
+                    is_int = false;
+                }
 
-            if (int ch = input.peek(); ch == 'e' || ch == 'E') {
-                read_char();
-                if (ch = input.peek(); ch == '+' || ch == '-') {
-                    read_char();
+                if (int ch = Peek(); ch == 'e' || ch == 'E') {
+                    ++pos_;
+                    if (ch = Peek(); ch == '+' || ch == '-') {
+                        ++pos_;
+                    }
+                    ReadDigits();
+                    is_int = false;
                 }
-                read_digits();
-                is_int = false;
+
+                return ConvertNumber({begin, static_cast<size_t>(pos_ - begin)}, is_int);
             }
 
-            try {
+            // An int if the number has no fraction or exponent and fits, a double otherwise, as
+            // std::stoi with a fallback to std::stod gave. std::from_chars reads the digits in
+            // place and does not depend on the locale.
+            static Node ConvertNumber(std::string_view parsed_num, bool is_int) {
+                const char *first = parsed_num.data();
+                const char *last = first + parsed_num.size();
                 if (is_int) {
-                    try {
-                        return std::stoi(parsed_num);
-                    } catch (...) {
+                    int value = 0;
+                    if (std::from_chars(first, last, value).ec == std::errc{}) {
+                        return value;
                     }
                 }
-                return std::stod(parsed_num);
-            } catch (...) {
-                throw ParsingError("Failed to convert "s + parsed_num + " to number"s);
+                // std::stod also rejected a result that underflows into the subnormal range.
+                double value = 0.0;
+                if (std::from_chars(first, last, value).ec != std::errc{} || std::fpclassify(value) == FP_SUBNORMAL) {
+                    throw ParsingError("Failed to convert "s + std::string(parsed_num) + " to number"s);
+                }
+                return value;
             }
-        }
 
-        Node LoadNode(std::istream &input) {
-            char c;
-            if (!(input >> c)) {
-                throw ParsingError("Unexpected EOF"s);
-            }
-            switch (c) {
-                case '[':
-                    return LoadArray(input);
-                case '{':
-                    return LoadDict(input);
-                case '"':
-                    return LoadString(input);
-                case 't':
-                    [[fallthrough]];
-                case 'f':
-                    input.putback(c);
-                    return LoadBool(input);
-                case 'n':
-                    input.putback(c);
-                    return LoadNull(input);
-                default:
-                    input.putback(c);
-                    return LoadNumber(input);
+            const char *pos_;
+            const char *end_;
+            std::vector<Node> array_stack_;
+            Dict::Entries dict_stack_;
+        };
+
+        std::string ReadAll(std::istream &input) {
+            std::string buffer;
+            char chunk[1 << 16];
+            while (input.read(chunk, sizeof(chunk)) || input.gcount() > 0) {
+                buffer.append(chunk, static_cast<size_t>(input.gcount()));
             }
+            return buffer;
+        }
+
+        // Runs one parser action from pos and advances pos past what it consumed.
+        template<typename Action>
+        auto Step(const char *&pos, const char *end, Action action) {
+            Parser parser({pos, static_cast<size_t>(end - pos)});
+            auto result = action(parser);
+            pos = parser.GetPosition();
+            return result;
         }
 
         struct PrintContext {
@@ -266,6 +459,44 @@ namespace json {
             PrintString(value, ctx.out);
         }
 
+        // The stream flags that change how `out << number` looks; the formats below reproduce
+        // the output of a stream without them.
+        bool HasCustomNumberFormat(const std::ostream &out) {
+            const auto flags = out.flags();
+            return (flags & std::ios::basefield) != std::ios::dec
+                   || (flags & (std::ios::floatfield | std::ios::showpoint | std::ios::showpos
+                                | std::ios::showbase | std::ios::uppercase)) || out.width() != 0;
+        }
+
+        template<>
+        void PrintValue<int>(const int &value, const PrintContext &ctx) {
+            if (HasCustomNumberFormat(ctx.out)) {
+                ctx.out << value;
+                return;
+            }
+            char buffer[16];
+            const auto result = std::to_chars(std::begin(buffer), std::end(buffer), value);
+            ctx.out.write(buffer, result.ptr - buffer);
+        }
+
+        // The %g format at the stream's precision, which is what `out << value` writes, without
+        // going through the locale and the stream's number formatting.
+        template<>
+        void PrintValue<double>(const double &value, const PrintContext &ctx) {
+            char buffer[64];
+            const auto result = HasCustomNumberFormat(ctx.out)
+                                    ? std::to_chars_result{nullptr, std::errc::not_supported}
+                                    : std::to_chars(std::begin(buffer), std::end(buffer), value,
+                                                    std::chars_format::general,
+                                                    static_cast<int>(ctx.out.precision()));
+            if (result.ec != std::errc{}) {
+                // A custom format, or a precision too large for the buffer.
+                ctx.out << value;
+                return;
+            }
+            ctx.out.write(buffer, result.ptr - buffer);
+        }
+
         template<>
         void PrintValue<std::nullptr_t>(const std::nullptr_t &, const PrintContext &ctx) {
             ctx.out << "null"sv;
@@ -320,19 +551,221 @@ namespace json {
         }
 
         void PrintNode(const Node &node, const PrintContext &ctx) {
-            std::visit(
-                [&ctx](const auto &value) {
-                    PrintValue(value, ctx);
-                },
-                node.GetValue());
+            node.Visit([&ctx](const auto &value) {
+                PrintValue(value, ctx);
+            });
+        }
+
+        bool KeyLess(const Dict::value_type &entry, std::string_view key) {
+            return entry.first < key;
+        }
+    }
+
+    Node::Node(const Node &other)
+        : payload_(other.payload_)
+        , type_(other.type_) {
+        switch (type_) {
+            case Type::STRING:
+                payload_.string = new std::string(*other.payload_.string);
+                break;
+            case Type::ARRAY:
+                payload_.array = new Array(*other.payload_.array);
+                break;
+            case Type::DICT:
+                payload_.dict = new Dict(*other.payload_.dict);
+                break;
+            default:
+                break;
+        }
+    }
+
+    bool Node::operator==(const Node &rhs) const {
+        if (type_ != rhs.type_) {
+            return false;
+        }
+        return Visit([&rhs](const auto &value) {
+            using Value = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<Value, std::nullptr_t>) {
+                return true;
+            } else {
+                return rhs.Visit([&value](const auto &rhs_value) {
+                    if constexpr (std::is_same_v<std::decay_t<decltype(rhs_value)>, Value>) {
+                        return value == rhs_value;
+                    } else {
+                        return false;
+                    }
+                });
+            }
+        });
+    }
+
+    void Node::Reset() noexcept {
+        switch (type_) {
+            case Type::STRING:
+                delete payload_.string;
+                break;
+            case Type::ARRAY:
+                delete payload_.array;
+                break;
+            case Type::DICT:
+                delete payload_.dict;
+                break;
+            default:
+                break;
+        }
+        type_ = Type::NULL_VALUE;
+    }
+
+    Dict::Dict(std::initializer_list<value_type> entries)
+        : entries_(entries) {
+        std::stable_sort(entries_.begin(), entries_.end(), [](const value_type &lhs, const value_type &rhs) {
+            return lhs.first < rhs.first;
+        });
+        const auto last = std::unique(entries_.begin(), entries_.end(), [](const value_type &lhs, const value_type &rhs) {
+            return lhs.first == rhs.first;
+        });
+        entries_.erase(last, entries_.end());
+    }
+
+    Dict::Dict(Entries entries)
+        : entries_(std::move(entries)) {
+        std::sort(entries_.begin(), entries_.end(), [](const value_type &lhs, const value_type &rhs) {
+            return lhs.first < rhs.first;
+        });
+    }
+
+    const Node &Dict::at(std::string_view key) const {
+        const auto it = find(key);
+        if (it == end()) {
+            throw std::out_of_range("Dict::at: no member '"s + std::string(key) + "'"s);
+        }
+        return it->second;
+    }
+
+    bool Dict::contains(std::string_view key) const {
+        return find(key) != end();
+    }
+
+    Dict::const_iterator Dict::find(std::string_view key) const {
+        const auto it = LowerBound(key);
+        return it != end() && it->first == key ? it : end();
+    }
+
+    Node &Dict::operator[](std::string key) {
+        auto it = LowerBound(key);
+        if (it == entries_.end() || it->first != key) {
+            it = entries_.emplace(it, std::move(key), Node{});
         }
+        return it->second;
+    }
+
+    bool Dict::operator==(const Dict &rhs) const {
+        return entries_ == rhs.entries_;
+    }
+
+    Dict::Entries::iterator Dict::LowerBound(std::string_view key) {
+        return std::lower_bound(entries_.begin(), entries_.end(), key, KeyLess);
+    }
+
+    Dict::const_iterator Dict::LowerBound(std::string_view key) const {
+        return std::lower_bound(entries_.begin(), entries_.end(), key, KeyLess);
+    }
+
+    Document Load(std::string_view input) {
+        return Document{Parser(input).LoadNode()};
     }
 
     Document Load(std::istream &input) {
-        return Document{LoadNode(input)};
+        return Load(std::string_view(ReadAll(input)));
+    }
+
+    PullParser::PullParser(std::string_view input)
+        : pos_(input.data())
+        , end_(input.data() + input.size()) {
+    }
+
+    PullParser::PullParser(std::istream &input)
+        : buffer_(ReadAll(input))
+        , pos_(buffer_.data())
+        , end_(buffer_.data() + buffer_.size()) {
+    }
+
+    bool PullParser::TryBeginArray() {
+        return Step(pos_, end_, [](Parser &parser) {
+            return parser.TryBeginArray();
+        });
+    }
+
+    bool PullParser::NextItem() {
+        return Step(pos_, end_, [](Parser &parser) {
+            return parser.NextItem();
+        });
+    }
+
+    bool PullParser::TryBeginDict() {
+        return Step(pos_, end_, [](Parser &parser) {
+            return parser.TryBeginDict();
+        });
+    }
+
+    bool PullParser::NextKey(std::string &key) {
+        return Step(pos_, end_, [&key](Parser &parser) {
+            return parser.NextKey(key);
+        });
+    }
+
+    Node PullParser::ReadNode() {
+        return Step(pos_, end_, [](Parser &parser) {
+            return parser.LoadNode();
+        });
     }
 
     void Print(const Document &doc, std::ostream &output) {
         PrintNode(doc.GetRoot(), PrintContext{output});
     }
+
+    ArrayWriter::ArrayWriter(std::ostream &output, size_t flush_interval)
+        : output_(output)
+        , flush_interval_(flush_interval)
+        , uncaught_exceptions_(std::uncaught_exceptions()) {
+        output_ << "[\n"sv;
+    }
+
+    ArrayWriter::~ArrayWriter() {
+        if (!closed_ && std::uncaught_exceptions() == uncaught_exceptions_) {
+            try {
+                Close();
+            } catch (...) {
+            }
+        }
+    }
+
+    void ArrayWriter::Write(const Node &node) {
+        if (closed_) {
+            throw std::logic_error("ArrayWriter: Write() called after Close()"s);
+        }
+        if (count_ != 0) {
+            output_ << ",\n"sv;
+        }
+        const PrintContext ctx = PrintContext{output_}.Indented();
+        ctx.PrintIndent();
+        PrintNode(node, ctx);
+        ++count_;
+        if (flush_interval_ != 0 && count_ % flush_interval_ == 0) {
+            Flush();
+        }
+    }
+
+    void ArrayWriter::Flush() {
+        output_.flush();
+    }
+
+    void ArrayWriter::Close() {
+        if (closed_) {
+            return;
+        }
+        closed_ = true;
+        output_ << "\n]"sv;
+        Flush();
+    }
 }
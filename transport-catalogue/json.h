@@ -1,14 +1,17 @@
 #pragma once
 
+#include <cstdint>
+#include <exception>
+#include <initializer_list>
 #include <iostream>
-#include <map>
+#include <stdexcept>
 #include <string>
-#include <variant>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace json {
     class Node;
-    using Dict = std::map<std::string, Node>;
     using Array = std::vector<Node>;
 
     class ParsingError : public std::runtime_error {
@@ -16,13 +19,122 @@ namespace json {
         using runtime_error::runtime_error;
     };
 
-    class Node final
-            : private std::variant<std::nullptr_t, Array, Dict, bool, int, double, std::string> {
+    // Members sorted by key in one vector: a lookup is a binary search and the whole object
+    // is a single allocation instead of a tree node per member. Iteration is in key order.
+    class Dict {
     public:
-        using variant::variant;
-        using Value = variant;
+        using value_type = std::pair<std::string, Node>;
+        using Entries = std::vector<value_type>;
+        using const_iterator = Entries::const_iterator;
 
-        Node(Value value) : variant(std::move(value)) {
+        Dict() = default;
+
+        // Like std::map, the first of several members with the same key is kept.
+        Dict(std::initializer_list<value_type> entries);
+
+        // Sorts the entries, whose keys must be unique.
+        explicit Dict(Entries entries);
+
+        const Node &at(std::string_view key) const;
+
+        bool contains(std::string_view key) const;
+
+        const_iterator find(std::string_view key) const;
+
+        // Inserts a null member if the key is missing.
+        Node &operator[](std::string key);
+
+        size_t size() const {
+            return entries_.size();
+        }
+
+        bool empty() const {
+            return entries_.empty();
+        }
+
+        const_iterator begin() const {
+            return entries_.begin();
+        }
+
+        const_iterator end() const {
+            return entries_.end();
+        }
+
+        bool operator==(const Dict &rhs) const;
+
+    private:
+        Entries::iterator LowerBound(std::string_view key);
+
+        const_iterator LowerBound(std::string_view key) const;
+
+        Entries entries_;
+    };
+
+    // A type tag and an eight-byte payload: scalars are stored inline, strings and containers
+    // are owned through a pointer. Moving a node copies the payload and leaves the source null.
+    class Node final {
+    public:
+        Node() = default;
+
+        Node(std::nullptr_t) {
+        }
+
+        Node(bool value)
+            : type_(Type::BOOL) {
+            payload_.boolean = value;
+        }
+
+        Node(int value)
+            : type_(Type::INT) {
+            payload_.integer = value;
+        }
+
+        Node(double value)
+            : type_(Type::DOUBLE) {
+            payload_.real = value;
+        }
+
+        Node(std::string value)
+            : type_(Type::STRING) {
+            payload_.string = new std::string(std::move(value));
+        }
+
+        Node(const char *value)
+            : Node(std::string(value)) {
+        }
+
+        Node(Array value)
+            : type_(Type::ARRAY) {
+            payload_.array = new Array(std::move(value));
+        }
+
+        Node(Dict value)
+            : type_(Type::DICT) {
+            payload_.dict = new Dict(std::move(value));
+        }
+
+        Node(const Node &other);
+
+        Node(Node &&other) noexcept
+            : payload_(other.payload_)
+            , type_(std::exchange(other.type_, Type::NULL_VALUE)) {
+        }
+
+        Node &operator=(const Node &other) {
+            return *this = Node(other);
+        }
+
+        Node &operator=(Node &&other) noexcept {
+            if (this != &other) {
+                Reset();
+                payload_ = other.payload_;
+                type_ = std::exchange(other.type_, Type::NULL_VALUE);
+            }
+            return *this;
+        }
+
+        ~Node() {
+            Reset();
         }
 
         Array &AsArray() {
@@ -30,7 +142,7 @@ namespace json {
             if (!IsArray()) {
                 throw std::logic_error("Not an array"s);
             }
-            return std::get<Array>(*this);
+            return *payload_.array;
         }
 
         Dict &AsDict() {
@@ -38,11 +150,11 @@ namespace json {
             if (!IsDict()) {
                 throw std::logic_error("Not a dict"s);
             }
-            return std::get<Dict>(*this);
+            return *payload_.dict;
         }
 
         bool IsInt() const {
-            return std::holds_alternative<int>(*this);
+            return type_ == Type::INT;
         }
 
         int AsInt() const {
@@ -50,11 +162,11 @@ namespace json {
             if (!IsInt()) {
                 throw std::logic_error("Not an int"s);
             }
-            return std::get<int>(*this);
+            return payload_.integer;
         }
 
         bool IsPureDouble() const {
-            return std::holds_alternative<double>(*this);
+            return type_ == Type::DOUBLE;
         }
 
         bool IsDouble() const {
@@ -66,11 +178,11 @@ namespace json {
             if (!IsDouble()) {
                 throw std::logic_error("Not a double"s);
             }
-            return IsPureDouble() ? std::get<double>(*this) : AsInt();
+            return IsPureDouble() ? payload_.real : AsInt();
         }
 
         bool IsBool() const {
-            return std::holds_alternative<bool>(*this);
+            return type_ == Type::BOOL;
         }
 
         bool AsBool() const {
@@ -79,15 +191,15 @@ namespace json {
                 throw std::logic_error("Not a bool"s);
             }
 
-            return std::get<bool>(*this);
+            return payload_.boolean;
         }
 
         bool IsNull() const {
-            return std::holds_alternative<std::nullptr_t>(*this);
+            return type_ == Type::NULL_VALUE;
         }
 
         bool IsArray() const {
-            return std::holds_alternative<Array>(*this);
+            return type_ == Type::ARRAY;
         }
 
         const Array &AsArray() const {
@@ -96,12 +208,12 @@ namespace json {
                 throw std::logic_error("Not an array"s);
             }
 
-            return std::get<Array>(*this);
+            return *payload_.array;
         }
 
 
         bool IsString() const {
-            return std::holds_alternative<std::string>(*this);
+            return type_ == Type::STRING;
         }
 
         const std::string &AsString() const {
@@ -110,11 +222,11 @@ namespace json {
                 throw std::logic_error("Not a string"s);
             }
 
-            return std::get<std::string>(*this);
+            return *payload_.string;
         }
 
         bool IsDict() const {
-            return std::holds_alternative<Dict>(*this);
+            return type_ == Type::DICT;
         }
 
         const Dict &AsDict() const {
@@ -123,16 +235,50 @@ namespace json {
                 throw std::logic_error("Not a dict"s);
             }
 
-            return std::get<Dict>(*this);
+            return *payload_.dict;
         }
 
-        bool operator==(const Node &rhs) const {
-            return GetValue() == rhs.GetValue();
+        // Calls visitor with the value: std::nullptr_t, bool, int, double, std::string, Array or Dict.
+        template<typename Visitor>
+        decltype(auto) Visit(Visitor &&visitor) const {
+            switch (type_) {
+                case Type::BOOL:
+                    return visitor(payload_.boolean);
+                case Type::INT:
+                    return visitor(payload_.integer);
+                case Type::DOUBLE:
+                    return visitor(payload_.real);
+                case Type::STRING:
+                    return visitor(*payload_.string);
+                case Type::ARRAY:
+                    return visitor(*payload_.array);
+                case Type::DICT:
+                    return visitor(*payload_.dict);
+                default:
+                    return visitor(nullptr);
+            }
         }
 
-        const Value &GetValue() const {
-            return *this;
-        }
+        bool operator==(const Node &rhs) const;
+
+    private:
+        enum class Type : uint8_t {
+            NULL_VALUE, BOOL, INT, DOUBLE, STRING, ARRAY, DICT
+        };
+
+        union Payload {
+            bool boolean;
+            int integer;
+            double real;
+            std::string *string;
+            Array *array;
+            Dict *dict;
+        };
+
+        void Reset() noexcept;
+
+        Payload payload_{};
+        Type type_ = Type::NULL_VALUE;
     };
 
     inline bool operator!=(const Node &lhs, const Node &rhs) {
@@ -161,7 +307,73 @@ namespace json {
         return !(lhs == rhs);
     }
 
+    // Parses the first JSON value of the text.
+    Document Load(std::string_view input);
+
+    // Reads the whole stream into memory, then parses it like Load(std::string_view).
     Document Load(std::istream &input);
 
+    // Walks the first JSON value of the text token by token, so that a large array or dict
+    // can be consumed entry by entry without building its Node tree; ReadNode builds the tree
+    // of a single value. Accepts and rejects the same input as Load.
+    class PullParser {
+    public:
+        explicit PullParser(std::string_view input);
+
+        // Reads the whole stream into memory and keeps it.
+        explicit PullParser(std::istream &input);
+
+        PullParser(const PullParser &) = delete;
+        PullParser &operator=(const PullParser &) = delete;
+
+        // Consumes the opening bracket if the next value is an array. Otherwise nothing is
+        // consumed and the value can still be read with ReadNode.
+        bool TryBeginArray();
+
+        // Moves to the next element of the array, or past its end, in which case it returns false.
+        bool NextItem();
+
+        bool TryBeginDict();
+
+        // Reads the next key of the dict, or moves past its end, in which case it returns false.
+        // Keys are not checked for duplicates.
+        bool NextKey(std::string &key);
+
+        Node ReadNode();
+
+    private:
+        std::string buffer_;
+        const char *pos_;
+        const char *end_;
+    };
+
     void Print(const Document &doc, std::ostream &output);
+
+    // Writes a JSON array one element at a time, in the layout of Print, so that an element
+    // can be dropped as soon as it is written. The array is opened on construction and closed
+    // by Close or, failing that, by the destructor. A destructor run by an exception leaves the
+    // array open, so a failed output does not look like a complete one.
+    class ArrayWriter {
+    public:
+        // With a nonzero flush_interval the output is flushed after every flush_interval elements.
+        explicit ArrayWriter(std::ostream &output, size_t flush_interval = 0);
+
+        ArrayWriter(const ArrayWriter &) = delete;
+        ArrayWriter &operator=(const ArrayWriter &) = delete;
+
+        ~ArrayWriter();
+
+        void Write(const Node &node);
+
+        void Flush();
+
+        void Close();
+
+    private:
+        std::ostream &output_;
+        size_t flush_interval_;
+        size_t count_ = 0;
+        bool closed_ = false;
+        int uncaught_exceptions_;
+    };
 }
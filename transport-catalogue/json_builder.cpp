@@ -77,8 +77,8 @@ namespace json {
         return KeyItemContext(*this);
     }
 
-    Builder &Builder::Value(Node::Value value) {
-        AddNode(Node(std::move(value)));
+    Builder &Builder::Value(Node value) {
+        AddNode(std::move(value));
         return *this;
     }
 
@@ -93,7 +93,7 @@ namespace json {
     }
 
 
-    DictItemContext KeyItemContext::Value(Node::Value value) const {
+    DictItemContext KeyItemContext::Value(Node value) const {
         builder_.Value(std::move(value));
         return DictItemContext(builder_);
     }
@@ -115,7 +115,7 @@ namespace json {
         return builder_.EndDict();
     }
 
-    ArrayItemContext ArrayItemContext::Value(Node::Value value) const {
+    ArrayItemContext ArrayItemContext::Value(Node value) const {
         builder_.Value(std::move(value));
         return *this;
     }
@@ -29,7 +29,7 @@ namespace json {
         Builder &EndDict();
         Builder &EndArray();
         KeyItemContext Key(std::string key);
-        Builder &Value(Node::Value value);
+        Builder &Value(Node value);
 
         Node Build();
 
@@ -46,7 +46,7 @@ namespace json {
     public:
         explicit KeyItemContext(Builder &builder) : BaseContext(builder) {}
 
-        DictItemContext Value(Node::Value value) const;
+        DictItemContext Value(Node value) const;
         DictItemContext StartDict() const;
         ArrayItemContext StartArray() const;
     };
@@ -63,7 +63,7 @@ namespace json {
     public:
         explicit ArrayItemContext(Builder &builder) : BaseContext(builder) {}
 
-        ArrayItemContext Value(Node::Value value) const;
+        ArrayItemContext Value(Node value) const;
         DictItemContext StartDict() const;
         ArrayItemContext StartArray() const;
         Builder &EndArray() const;
@@ -1,7 +1,43 @@
 #include "json_reader.h"
+#include <algorithm>
+#include <optional>
 #include <sstream>
+#include <stdexcept>
+#include <thread>
 
 namespace transport_catalogue::readers {
+    namespace {
+        using namespace std::literals;
+
+        // Rejects a key seen before in the same dict, as json::Load does.
+        void CheckUniqueKey(std::vector<std::string> &keys, const std::string &key) {
+            if (std::find(keys.begin(), keys.end(), key) != keys.end()) {
+                throw json::ParsingError("Duplicate key '"s + key + "' have been found");
+            }
+            keys.push_back(key);
+        }
+
+        const json::Node &Require(const std::optional<json::Node> &field, std::string_view key) {
+            if (!field) {
+                throw std::out_of_range("Missing key '"s + std::string(key) + "'"s);
+            }
+            return *field;
+        }
+
+        // Any other value is read and rejected by AsDict, so it fails as it did with json::Load.
+        void BeginDict(json::PullParser &parser) {
+            if (!parser.TryBeginDict()) {
+                parser.ReadNode().AsDict();
+            }
+        }
+
+        void BeginArray(json::PullParser &parser) {
+            if (!parser.TryBeginArray()) {
+                parser.ReadNode().AsArray();
+            }
+        }
+    }
+
     std::string JsonReader::NodeToColor(const json::Node &node) {
         if (node.IsString()) {
             return node.AsString();
@@ -22,20 +58,24 @@ namespace transport_catalogue::readers {
     }
 
     void JsonReader::Load(std::istream &input) {
-        const json::Document doc = json::Load(input);
-        const auto &root = doc.GetRoot().AsDict();
+        json::PullParser parser(input);
+        BeginDict(parser);
 
-        if (root.contains("base_requests")) {
-            ParseBaseRequests(root.at("base_requests"));
-        }
-        if (root.contains("render_settings")) {
-            ParseRenderSettings(root.at("render_settings"));
-        }
-        if (root.contains("routing_settings")) {
-            ParseRoutingSettings(root.at("routing_settings"));
-        }
-        if (root.contains("stat_requests")) {
-            stat_requests_ = root.at("stat_requests").AsArray();
+        std::vector<std::string> keys;
+        std::string key;
+        while (parser.NextKey(key)) {
+            CheckUniqueKey(keys, key);
+            if (key == "base_requests") {
+                ParseBaseRequests(parser);
+            } else if (key == "render_settings") {
+                ParseRenderSettings(parser.ReadNode());
+            } else if (key == "routing_settings") {
+                ParseRoutingSettings(parser.ReadNode());
+            } else if (key == "stat_requests") {
+                stat_requests_ = std::move(parser.ReadNode().AsArray());
+            } else {
+                parser.ReadNode();
+            }
         }
     }
 
@@ -43,7 +83,7 @@ namespace transport_catalogue::readers {
         for (const auto &cmd: commands_) {
             if (std::holds_alternative<StopCommand>(cmd)) {
                 const auto &stop = std::get<StopCommand>(cmd);
-                catalogue_.AddStop(stop.id, {stop.latitude, stop.longitude});
+                catalogue_.AddStop(names_by_id_[stop.id], {stop.latitude, stop.longitude});
             }
         }
 
@@ -51,7 +91,7 @@ namespace transport_catalogue::readers {
             if (std::holds_alternative<StopCommand>(cmd)) {
                 const auto &stop = std::get<StopCommand>(cmd);
                 for (const auto &[other_stop, dist]: stop.distances) {
-                    catalogue_.SetDistance(stop.id, other_stop, dist);
+                    catalogue_.SetDistance(names_by_id_[stop.id], names_by_id_[other_stop], dist);
                 }
             }
         }
@@ -61,12 +101,13 @@ namespace transport_catalogue::readers {
                 const auto &bus = std::get<BusCommand>(cmd);
                 std::vector<std::string_view> stops_view;
                 stops_view.reserve(bus.stops.size());
-                for (const auto &s: bus.stops) {
-                    stops_view.push_back(s);
+                for (const NameId stop: bus.stops) {
+                    stops_view.push_back(names_by_id_[stop]);
                 }
-                catalogue_.AddBus(bus.id, stops_view, bus.is_roundtrip);
+                catalogue_.AddBus(names_by_id_[bus.id], stops_view, bus.is_roundtrip);
             }
         }
+        catalogue_.Freeze();
     }
 
     const std::vector<json::Node> &JsonReader::GetStatRequests() const {
@@ -81,32 +122,81 @@ namespace transport_catalogue::readers {
         return route_settings_;
     }
 
-    void JsonReader::ParseBaseRequests(const json::Node &base_requests_node) {
-        for (const auto &item: base_requests_node.AsArray()) {
-            const auto &m = item.AsDict();
-            const std::string type = m.at("type").AsString();
-
-            if (type == "Stop") {
-                StopCommand cmd;
-                cmd.id = m.at("name").AsString();
-                cmd.latitude = m.at("latitude").AsDouble();
-                cmd.longitude = m.at("longitude").AsDouble();
-                if (m.find("road_distances") != m.end()) {
-                    for (const auto &[stop_name, dist_node]: m.at("road_distances").AsDict()) {
-                        cmd.distances.emplace_back(stop_name, dist_node.AsInt());
-                    }
+    NameId JsonReader::InternName(std::string_view name) {
+        if (const auto it = name_ids_.find(name); it != name_ids_.end()) {
+            return it->second;
+        }
+        const auto id = static_cast<NameId>(names_by_id_.size());
+        const std::string_view stored = catalogue_.StoreName(name);
+        names_by_id_.push_back(stored);
+        name_ids_.emplace(stored, id);
+        return id;
+    }
+
+    void JsonReader::ParseBaseRequests(json::PullParser &parser) {
+        BeginArray(parser);
+        std::vector<std::string> keys;
+        while (parser.NextItem()) {
+            ParseBaseRequest(parser, keys);
+        }
+    }
+
+    void JsonReader::ParseBaseRequest(json::PullParser &parser, std::vector<std::string> &keys) {
+        BeginDict(parser);
+
+        // The keys may come in any order, so the request is built once the dict is read. The
+        // stops of a bus are interned as they are read instead of being kept as Nodes.
+        std::optional<json::Node> type, name, latitude, longitude, road_distances, is_roundtrip;
+        std::optional<std::vector<NameId> > stops;
+        keys.clear();
+        std::string key;
+        while (parser.NextKey(key)) {
+            CheckUniqueKey(keys, key);
+            if (key == "stops") {
+                BeginArray(parser);
+                stops.emplace();
+                while (parser.NextItem()) {
+                    stops->push_back(InternName(parser.ReadNode().AsString()));
                 }
-                commands_.emplace_back(std::move(cmd));
-            } else if (type == "Bus") {
-                BusCommand cmd;
-                cmd.id = m.at("name").AsString();
-                const auto &stops_array = m.at("stops").AsArray();
-                for (const auto &stop_node: stops_array) {
-                    cmd.stops.push_back(stop_node.AsString());
+                continue;
+            }
+            json::Node value = parser.ReadNode();
+            if (key == "type") {
+                type = std::move(value);
+            } else if (key == "name") {
+                name = std::move(value);
+            } else if (key == "latitude") {
+                latitude = std::move(value);
+            } else if (key == "longitude") {
+                longitude = std::move(value);
+            } else if (key == "road_distances") {
+                road_distances = std::move(value);
+            } else if (key == "is_roundtrip") {
+                is_roundtrip = std::move(value);
+            }
+        }
+
+        const std::string &request_type = Require(type, "type").AsString();
+        if (request_type == "Stop") {
+            StopCommand cmd;
+            cmd.id = InternName(Require(name, "name").AsString());
+            cmd.latitude = Require(latitude, "latitude").AsDouble();
+            cmd.longitude = Require(longitude, "longitude").AsDouble();
+            if (road_distances) {
+                for (const auto &[stop_name, dist_node]: road_distances->AsDict()) {
+                    cmd.distances.emplace_back(InternName(stop_name), dist_node.AsInt());
                 }
-                cmd.is_roundtrip = m.at("is_roundtrip").AsBool();
-                commands_.emplace_back(std::move(cmd));
             }
+            commands_.emplace_back(std::move(cmd));
+        } else if (request_type == "Bus") {
+            BusCommand cmd;
+            cmd.id = InternName(Require(name, "name").AsString());
+            if (!stops) {
+                throw std::out_of_range("Missing key 'stops'"s);
+            }
+            cmd.stops = std::move(*stops);
+            cmd.is_roundtrip = Require(is_roundtrip, "is_roundtrip").AsBool();
+            commands_.emplace_back(std::move(cmd));
         }
     }
 
@@ -141,5 +231,42 @@ namespace transport_catalogue::readers {
         const auto &m = node.AsDict();
         route_settings_.bus_velocity = m.at("bus_velocity").AsDouble();
         route_settings_.bus_wait_time = m.at("bus_wait_time").AsInt();
+        if (m.contains("router_mode")) {
+            route_settings_.router_mode = ParseRouterMode(m.at("router_mode").AsString());
+        }
+        if (m.contains("route_cache_size")) {
+            const int cache_size = m.at("route_cache_size").AsInt();
+            if (cache_size < 1) {
+                throw std::invalid_argument("route_cache_size must be positive: " + std::to_string(cache_size));
+            }
+            route_settings_.route_cache_size = cache_size;
+        }
+        if (m.contains("router_threads")) {
+            const int threads = m.at("router_threads").AsInt();
+            route_settings_.router_threads = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+        }
+        if (m.contains("routing_table_file")) {
+            route_settings_.routing_table_file = m.at("routing_table_file").AsString();
+        }
+    }
+
+    transport_router::RouterMode JsonReader::ParseRouterMode(const std::string &mode) {
+        using transport_router::RouterMode;
+        if (mode == "all_pairs") {
+            return RouterMode::ALL_PAIRS;
+        } else if (mode == "all_pairs_flat") {
+            return RouterMode::ALL_PAIRS_FLAT;
+        } else if (mode == "dijkstra") {
+            return RouterMode::DIJKSTRA;
+        } else if (mode == "contraction_hierarchies") {
+            return RouterMode::CONTRACTION_HIERARCHIES;
+        } else if (mode == "a_star") {
+            return RouterMode::A_STAR;
+        } else if (mode == "bidirectional_dijkstra") {
+            return RouterMode::BIDIRECTIONAL_DIJKSTRA;
+        } else if (mode == "raptor") {
+            return RouterMode::RAPTOR;
+        }
+        throw std::invalid_argument("Unknown router mode: " + mode);
     }
 }
\ No newline at end of file
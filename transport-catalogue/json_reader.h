@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 #include <variant>
 #include <utility>
@@ -10,16 +13,19 @@
 #include "transport_router.h"
 
 namespace transport_catalogue::readers {
+    // Index of a stop or bus name in the name pool of a JsonReader.
+    using NameId = uint32_t;
+
     struct StopCommand {
-        std::string id;
+        NameId id = 0;
         double latitude = 0.0;
         double longitude = 0.0;
-        std::vector<std::pair<std::string, int> > distances;
+        std::vector<std::pair<NameId, int> > distances;
     };
 
     struct BusCommand {
-        std::string id;
-        std::vector<std::string> stops;
+        NameId id = 0;
+        std::vector<NameId> stops;
         bool is_roundtrip = false;
     };
 
@@ -29,6 +35,8 @@ namespace transport_catalogue::readers {
     public:
         explicit JsonReader(TransportCatalogue &catalogue);
 
+        // Streams base_requests into commands one request at a time; only the settings and
+        // stat_requests are kept as Node trees.
         void Load(std::istream &input);
 
         void ApplyCommands() const;
@@ -42,16 +50,26 @@ namespace transport_catalogue::readers {
     private:
         TransportCatalogue &catalogue_;
         std::vector<Command> commands_;
+        // Every name of the commands, stored once in the catalogue however many commands refer
+        // to it.
+        std::vector<std::string_view> names_by_id_;
+        std::unordered_map<std::string_view, NameId> name_ids_;
         std::vector<json::Node> stat_requests_;
         renderer::RenderSettings map_settings_;
         transport_router::RoutingSettings route_settings_;
 
-        void ParseBaseRequests(const json::Node &base_requests_node);
+        NameId InternName(std::string_view name);
+
+        void ParseBaseRequests(json::PullParser &parser);
+
+        void ParseBaseRequest(json::PullParser &parser, std::vector<std::string> &keys);
 
         void ParseRenderSettings(const json::Node &node);
 
         void ParseRoutingSettings(const json::Node &node);
 
         [[nodiscard]] static std::string NodeToColor(const json::Node &node);
+
+        [[nodiscard]] static transport_router::RouterMode ParseRouterMode(const std::string &mode);
     };
 }
\ No newline at end of file
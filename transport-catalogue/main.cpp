@@ -15,8 +15,5 @@ int main() {
     handler.Load(std::cin);
     handler.ApplyCommands();
 
-    json::Array result = handler.ProcessRequests();
-
-
-    json::Print(json::Document{json::Node(result)}, std::cout);
+    handler.ProcessRequests(std::cout);
 }
@@ -1,48 +1,49 @@
 #include "map_renderer.h"
 
-#include <set>
-
 namespace transport_catalogue::renderer {
     MapRenderer::MapRenderer(const TransportCatalogue &catalogue, const RenderSettings &settings)
-        : catalogue_(catalogue), settings_(settings) {
+        : catalogue_(catalogue), settings_(settings)
+        , unique_stops_(CollectUniqueStops())
+        , projector_(CreateProjector(unique_stops_)) {
     }
 
     svg::Document MapRenderer::Render() const {
         svg::Document doc;
 
-        const auto unique_stops = CollectUniqueStops();
-
-        const auto projector = CreateProjector(unique_stops);
-
-        DrawBusLines(doc, projector);
+        DrawBusLines(doc, projector_);
 
-        DrawBusLabels(doc, projector);
+        DrawBusLabels(doc, projector_);
 
-        DrawStopCircles(doc, unique_stops, projector);
+        DrawStopCircles(doc, unique_stops_, projector_);
 
-        DrawStopLabels(doc, unique_stops, projector);
+        DrawStopLabels(doc, unique_stops_, projector_);
 
         return doc;
     }
 
-    std::unordered_set<const domain::Stop *> MapRenderer::CollectUniqueStops() const {
-        std::unordered_set<const domain::Stop *> unique_stops;
+    std::vector<domain::StopId> MapRenderer::CollectUniqueStops() const {
+        std::vector<domain::StopId> unique_stops;
 
-        for (const auto &bus_name: catalogue_.GetAllBusNames()) {
-            if (const auto *bus = catalogue_.FindBus(bus_name)) {
-                unique_stops.insert(bus->stops.begin(), bus->stops.end());
-            }
+        for (const domain::BusId bus: catalogue_.GetAllBuses()) {
+            const auto stops = catalogue_.GetBusStops(bus);
+            unique_stops.insert(unique_stops.end(), stops.begin(), stops.end());
         }
+        std::sort(unique_stops.begin(), unique_stops.end());
+        unique_stops.erase(std::unique(unique_stops.begin(), unique_stops.end()), unique_stops.end());
+        // Stops are drawn in name order.
+        std::sort(unique_stops.begin(), unique_stops.end(), [this](domain::StopId lhs, domain::StopId rhs) {
+            return catalogue_.GetStopName(lhs) < catalogue_.GetStopName(rhs);
+        });
         return unique_stops;
     }
 
 
-    SphereProjector MapRenderer::CreateProjector(const std::unordered_set<const domain::Stop *> &stops) const {
+    SphereProjector MapRenderer::CreateProjector(const std::vector<domain::StopId> &stops) const {
         std::vector<geo::Coordinates> coords;
         coords.reserve(stops.size());
 
-        for (const auto *stop: stops) {
-            coords.push_back(stop->coordinates);
+        for (const domain::StopId stop: stops) {
+            coords.push_back(catalogue_.GetStopCoordinates(stop));
         }
 
         return {
@@ -52,13 +53,10 @@ namespace transport_catalogue::renderer {
     }
 
     void MapRenderer::DrawBusLines(svg::Document &doc, const SphereProjector &projector) const {
-        auto all_buses = catalogue_.GetAllBusNames();
-        std::sort(all_buses.begin(), all_buses.end());
-
         size_t color_index = 0;
-        for (const auto &bus_name: all_buses) {
-            const auto *bus = catalogue_.FindBus(bus_name);
-            if (!bus || bus->stops.empty()) continue;
+        for (const domain::BusId bus: catalogue_.GetAllBuses()) {
+            const auto stops = catalogue_.GetBusStops(bus);
+            if (stops.empty()) continue;
 
             svg::Polyline line;
             line.SetStrokeColor(settings_.color_palette[color_index % settings_.color_palette.size()])
@@ -67,8 +65,8 @@ namespace transport_catalogue::renderer {
                     .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND)
                     .SetFillColor(svg::NoneColor);
 
-            for (const auto *stop: bus->stops) {
-                line.AddPoint(projector(stop->coordinates));
+            for (const domain::StopId stop: stops) {
+                line.AddPoint(projector(catalogue_.GetStopCoordinates(stop)));
             }
 
             doc.Add(line);
@@ -77,26 +75,23 @@ namespace transport_catalogue::renderer {
     }
 
     void MapRenderer::DrawBusLabels(svg::Document &doc, const SphereProjector &projector) const {
-        auto all_buses = catalogue_.GetAllBusNames();
-        std::sort(all_buses.begin(), all_buses.end());
-
         size_t color_index = 0;
-        for (const auto &bus_name: all_buses) {
-            const auto *bus = catalogue_.FindBus(bus_name);
-            if (!bus || bus->stops.empty()) continue;
+        for (const domain::BusId bus: catalogue_.GetAllBuses()) {
+            const auto stops = catalogue_.GetBusStops(bus);
+            if (stops.empty()) continue;
 
-            std::vector<const domain::Stop *> end_stops = {bus->stops.front()};
+            std::vector<domain::StopId> end_stops = {stops.front()};
 
-            if (!bus->is_roundtrip) {
-                const size_t half = (bus->stops.size() + 1) / 2;
-                const domain::Stop *last_direct_stop = bus->stops[half - 1];
-                if (bus->stops.front()->name != last_direct_stop->name) {
+            if (!catalogue_.IsRoundtrip(bus)) {
+                const size_t half = (stops.size() + 1) / 2;
+                const domain::StopId last_direct_stop = stops[half - 1];
+                if (stops.front() != last_direct_stop) {
                     end_stops.push_back(last_direct_stop);
                 }
             }
 
-            for (const auto *stop: end_stops) {
-                AddBusLabel(doc, bus->name, projector(stop->coordinates), color_index);
+            for (const domain::StopId stop: end_stops) {
+                AddBusLabel(doc, catalogue_.GetBusName(bus), projector(catalogue_.GetStopCoordinates(stop)), color_index);
             }
 
             ++color_index;
@@ -104,19 +99,11 @@ namespace transport_catalogue::renderer {
     }
 
     void MapRenderer::DrawStopCircles(svg::Document &doc,
-                                      const std::unordered_set<const domain::Stop *> &unique_stops,
+                                      const std::vector<domain::StopId> &unique_stops,
                                       const SphereProjector &projector) const {
-        std::set<std::string> stop_names;
-        for (const auto *stop: unique_stops) {
-            stop_names.insert(std::string(stop->name));
-        }
-
-        for (const auto &name: stop_names) {
-            const domain::Stop *stop = catalogue_.FindStop(name);
-            if (!stop) continue;
-
+        for (const domain::StopId stop: unique_stops) {
             svg::Circle circle;
-            circle.SetCenter(projector(stop->coordinates))
+            circle.SetCenter(projector(catalogue_.GetStopCoordinates(stop)))
                     .SetRadius(settings_.stop_radius)
                     .SetFillColor("white");
             doc.Add(circle);
@@ -124,18 +111,10 @@ namespace transport_catalogue::renderer {
     }
 
     void MapRenderer::DrawStopLabels(svg::Document &doc,
-                                     const std::unordered_set<const domain::Stop *> &unique_stops,
+                                     const std::vector<domain::StopId> &unique_stops,
                                      const SphereProjector &projector) const {
-        std::set<std::string> stop_names;
-        for (const auto *stop: unique_stops) {
-            stop_names.insert(std::string(stop->name));
-        }
-
-        for (const auto &name: stop_names) {
-            const domain::Stop *stop = catalogue_.FindStop(name);
-            if (!stop) continue;
-
-            const svg::Point pos = projector(stop->coordinates);
+        for (const domain::StopId stop: unique_stops) {
+            const svg::Point pos = projector(catalogue_.GetStopCoordinates(stop));
 
 
             svg::Text underlayer;
@@ -148,7 +127,7 @@ namespace transport_catalogue::renderer {
                     .SetStrokeWidth(settings_.underlayer_width)
                     .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
                     .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND)
-                    .SetData(std::string(stop->name));
+                    .SetData(std::string(catalogue_.GetStopName(stop)));
             doc.Add(underlayer);
 
 
@@ -158,7 +137,7 @@ namespace transport_catalogue::renderer {
                     .SetFontSize(settings_.stop_label_font_size)
                     .SetFontFamily("Verdana")
                     .SetFillColor("black")
-                    .SetData(std::string(stop->name));
+                    .SetData(std::string(catalogue_.GetStopName(stop)));
             doc.Add(text);
         }
     }
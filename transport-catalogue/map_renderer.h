@@ -3,7 +3,6 @@
 #include <sstream>
 #include <algorithm>
 #include <optional>
-#include <unordered_set>
 #include <vector>
 #include <string>
 
@@ -99,23 +98,26 @@ namespace transport_catalogue::renderer {
     private:
         const TransportCatalogue &catalogue_;
         const RenderSettings &settings_;
+        // Computed once at construction and shared by every Render call.
+        std::vector<domain::StopId> unique_stops_;
+        SphereProjector projector_;
 
         void AddBusLabel(svg::Document &doc, std::string_view bus_name, svg::Point pos, size_t color_index) const;
 
-        [[nodiscard]] std::unordered_set<const domain::Stop *> CollectUniqueStops() const;
+        [[nodiscard]] std::vector<domain::StopId> CollectUniqueStops() const;
 
-        [[nodiscard]] SphereProjector CreateProjector(const std::unordered_set<const domain::Stop *> &stops) const;
+        [[nodiscard]] SphereProjector CreateProjector(const std::vector<domain::StopId> &stops) const;
 
         void DrawBusLines(svg::Document &doc, const SphereProjector &projector) const;
 
         void DrawBusLabels(svg::Document &doc, const SphereProjector &projector) const;
 
         void DrawStopCircles(svg::Document &doc,
-                             const std::unordered_set<const domain::Stop *> &unique_stops,
+                             const std::vector<domain::StopId> &unique_stops,
                              const SphereProjector &projector) const;
 
         void DrawStopLabels(svg::Document &doc,
-                            const std::unordered_set<const domain::Stop *> &unique_stops,
+                            const std::vector<domain::StopId> &unique_stops,
                             const SphereProjector &projector) const;
     };
 }
@@ -0,0 +1,37 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace transport_router {
+    std::unique_ptr<MappedFile> MappedFile::Open(const std::string &path) {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return nullptr;
+        }
+        struct stat file_stat {};
+        if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+            close(fd);
+            return nullptr;
+        }
+        const size_t size = static_cast<size_t>(file_stat.st_size);
+        void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping keeps its own reference to the file.
+        close(fd);
+        if (data == MAP_FAILED) {
+            return nullptr;
+        }
+        return std::unique_ptr<MappedFile>(new MappedFile(static_cast<const std::byte *>(data), size));
+    }
+
+    MappedFile::MappedFile(const std::byte *data, size_t size)
+        : data_(data)
+        , size_(size) {
+    }
+
+    MappedFile::~MappedFile() {
+        munmap(const_cast<std::byte *>(data_), size_);
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+
+namespace transport_router {
+    // Read-only memory mapping of a whole file, unmapped on destruction.
+    class MappedFile {
+    public:
+        // Returns nullptr if the file does not exist, is empty or cannot be mapped.
+        static std::unique_ptr<MappedFile> Open(const std::string &path);
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        ~MappedFile();
+
+        std::span<const std::byte> GetData() const {
+            return {data_, size_};
+        }
+
+    private:
+        MappedFile(const std::byte *data, size_t size);
+
+        const std::byte *data_;
+        size_t size_;
+    };
+}
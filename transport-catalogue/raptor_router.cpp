@@ -0,0 +1,154 @@
+#include "raptor_router.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace transport_router {
+
+    namespace {
+        constexpr double UNREACHED = std::numeric_limits<double>::infinity();
+        constexpr size_t NO_POSITION = std::numeric_limits<size_t>::max();
+    }
+
+    RaptorRouter::RaptorRouter(size_t stop_count, double wait_time, double velocity)
+        : stop_count_(stop_count)
+        , wait_time_(wait_time)
+        , velocity_(velocity)
+        , stop_lines_(stop_count) {
+    }
+
+    void RaptorRouter::AddLine(Line line) {
+        if (line.stops.size() != line.distances.size()) {
+            throw std::invalid_argument("Line stops and distances differ in size");
+        }
+        for (const size_t stop: line.stops) {
+            if (stop >= stop_count_) {
+                throw std::out_of_range("Stop index is out of range");
+            }
+        }
+
+        const size_t line_id = lines_.size();
+        for (size_t position = 0; position < line.stops.size(); ++position) {
+            stop_lines_[line.stops[position]].push_back({line_id, position});
+        }
+        lines_.push_back(std::move(line));
+    }
+
+    double RaptorRouter::GetRideTime(const Line &line, size_t board_position, size_t alight_position) const {
+        // Same expression as the graph's ride edges, so equal routes give bit-equal times.
+        const double distance = line.distances[alight_position] - line.distances[board_position];
+        return (distance / 1000.0) / velocity_ * 60.0;
+    }
+
+    RaptorRouter::Rounds RaptorRouter::Search(size_t from, std::optional<size_t> target,
+                                              std::vector<double> &best_arrivals) const {
+        best_arrivals.assign(stop_count_, UNREACHED);
+        best_arrivals[from] = 0.0;
+        Rounds labels(1, std::vector<Label>(stop_count_));
+        labels[0][from] = Label{0.0, 0, 0, 0, true};
+
+        std::vector<size_t> marked_stops{from};
+        std::vector<bool> is_marked(stop_count_, false);
+        std::vector<size_t> first_positions(lines_.size(), NO_POSITION);
+        std::vector<size_t> queued_lines;
+        while (!marked_stops.empty()) {
+            // A line only needs scanning from its first stop improved in the previous round.
+            for (const size_t stop: marked_stops) {
+                is_marked[stop] = false;
+                for (const auto [line_id, position]: stop_lines_[stop]) {
+                    if (first_positions[line_id] == NO_POSITION) {
+                        queued_lines.push_back(line_id);
+                    }
+                    first_positions[line_id] = std::min(first_positions[line_id], position);
+                }
+            }
+            marked_stops.clear();
+
+            const std::vector<double> previous_arrivals = best_arrivals;
+            auto &round = labels.emplace_back(stop_count_);
+            for (const size_t line_id: queued_lines) {
+                const Line &line = lines_[line_id];
+                size_t board_position = NO_POSITION;
+                double board_weight = 0.0;
+                for (size_t position = first_positions[line_id]; position < line.stops.size(); ++position) {
+                    const size_t stop = line.stops[position];
+                    double trip_arrival = UNREACHED;
+                    if (board_position != NO_POSITION) {
+                        trip_arrival = board_weight + GetRideTime(line, board_position, position);
+                        const double bound = target ? std::min(best_arrivals[stop], best_arrivals[*target])
+                                                    : best_arrivals[stop];
+                        if (trip_arrival < bound) {
+                            best_arrivals[stop] = trip_arrival;
+                            round[stop] = Label{trip_arrival, line_id, board_position, position, true};
+                            if (!is_marked[stop]) {
+                                is_marked[stop] = true;
+                                marked_stops.push_back(stop);
+                            }
+                        }
+                    }
+                    // Boarding here is better for every later stop as soon as it beats the
+                    // bus already boarded, because ride times grow with distance alone.
+                    if (previous_arrivals[stop] + wait_time_ < trip_arrival) {
+                        board_position = position;
+                        board_weight = previous_arrivals[stop] + wait_time_;
+                    }
+                }
+                first_positions[line_id] = NO_POSITION;
+            }
+            queued_lines.clear();
+        }
+        return labels;
+    }
+
+    std::optional<RaptorRouter::Journey> RaptorRouter::BuildRoute(size_t from, size_t to) const {
+        if (from >= stop_count_ || to >= stop_count_) {
+            throw std::out_of_range("Stop index is out of range");
+        }
+        std::vector<double> best_arrivals;
+        const Rounds labels = Search(from, to, best_arrivals);
+        if (best_arrivals[to] == UNREACHED) {
+            return std::nullopt;
+        }
+
+        // The boarding stop of a ride found in round k was labelled in the latest round
+        // before k that improved it; round 0 holds only the origin.
+        Journey journey{best_arrivals[to], {}};
+        size_t stop = to;
+        size_t round = labels.size() - 1;
+        while (true) {
+            while (!labels[round][stop].is_set) {
+                --round;
+            }
+            if (round == 0) {
+                break;
+            }
+            const Label &label = labels[round][stop];
+            const Line &line = lines_[label.line];
+            const size_t board_stop = line.stops[label.board_position];
+            journey.rides.push_back(Ride{label.line, board_stop,
+                                         static_cast<int>(label.alight_position - label.board_position),
+                                         GetRideTime(line, label.board_position, label.alight_position)});
+            stop = board_stop;
+            --round;
+        }
+        std::reverse(journey.rides.begin(), journey.rides.end());
+        return journey;
+    }
+
+    std::vector<std::optional<double> > RaptorRouter::BuildTimesFrom(size_t from,
+                                                                    const std::vector<size_t> &targets) const {
+        if (from >= stop_count_) {
+            throw std::out_of_range("Stop index is out of range");
+        }
+        std::vector<double> best_arrivals;
+        Search(from, std::nullopt, best_arrivals);
+
+        std::vector<std::optional<double> > times;
+        times.reserve(targets.size());
+        for (const size_t target: targets) {
+            times.push_back(best_arrivals.at(target) != UNREACHED ? std::optional(best_arrivals[target]) : std::nullopt);
+        }
+        return times;
+    }
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+namespace transport_router {
+
+    // Round-based search over the buses' stop sequences (RAPTOR). Round k scans every line
+    // that serves a stop improved in round k - 1 once, in stop order, and finds the best
+    // arrival at every stop with at most k rides. A line of n stops therefore costs O(n) per
+    // round instead of the O(n^2) stop-pair edges of the routing graph. The cost model is the
+    // graph's one: every boarding costs wait_time, a ride costs its road distance at velocity.
+    class RaptorRouter {
+    public:
+        struct Line {
+            // Stop indices in the order the bus passes them.
+            std::vector<size_t> stops;
+            // Road distance from the first stop to each stop, meters.
+            std::vector<double> distances;
+        };
+
+        struct Ride {
+            size_t line = 0;
+            size_t board_stop = 0;
+            int span_count = 0;
+            double time = 0.0;
+        };
+
+        struct Journey {
+            double total_time = 0.0;
+            std::vector<Ride> rides;
+        };
+
+        RaptorRouter(size_t stop_count, double wait_time, double velocity);
+
+        // Line ids are assigned in the order the lines are added, starting from 0.
+        void AddLine(Line line);
+
+        std::optional<Journey> BuildRoute(size_t from, size_t to) const;
+
+        // Best total time from one stop to each of the targets, std::nullopt if unreachable.
+        std::vector<std::optional<double>> BuildTimesFrom(size_t from, const std::vector<size_t> &targets) const;
+
+    private:
+        struct Label {
+            double arrival = 0.0;
+            size_t line = 0;
+            size_t board_position = 0;
+            size_t alight_position = 0;
+            bool is_set = false;
+        };
+
+        struct LinePosition {
+            size_t line;
+            size_t position;
+        };
+
+        // labels[k][stop] is set if the arrival at stop was improved in round k.
+        using Rounds = std::vector<std::vector<Label> >;
+
+        Rounds Search(size_t from, std::optional<size_t> target, std::vector<double> &best_arrivals) const;
+
+        double GetRideTime(const Line &line, size_t board_position, size_t alight_position) const;
+
+        size_t stop_count_;
+        double wait_time_;
+        double velocity_;
+        std::vector<Line> lines_;
+        std::vector<std::vector<LinePosition> > stop_lines_;
+    };
+
+}
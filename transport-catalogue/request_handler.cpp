@@ -1,4 +1,5 @@
 #include "request_handler.h"
+#include <cassert>
 #include <sstream>
 
 namespace transport_catalogue::readers {
@@ -10,113 +11,221 @@ namespace transport_catalogue::readers {
 
     void RequestHandler::Load(std::istream& input) {
         reader_.Load(input);
+        router_.reset();
+        renderer_.reset();
     }
 
     void RequestHandler::ApplyCommands() const {
         reader_.ApplyCommands();
+        router_.reset();
+        renderer_.reset();
     }
 
-    json::Array RequestHandler::ProcessRequests() const {
-        const auto& settings = reader_.GetMapSettings();
-        const renderer::MapRenderer renderer(catalogue_, settings);
+    const transport_router::TransportRouter& RequestHandler::GetRouter() const {
+        if (!router_) {
+            router_ = std::make_unique<transport_router::TransportRouter>();
+            router_->SetRoutingSettings(reader_.GetRouteSettings());
+            router_->BuildGraph(catalogue_);
+        }
+        return *router_;
+    }
 
-        transport_router::TransportRouter router;
-        router.SetRoutingSettings(reader_.GetRouteSettings());
-        router.BuildGraph(catalogue_);
+    const renderer::MapRenderer& RequestHandler::GetRenderer() const {
+        if (!renderer_) {
+            renderer_ = std::make_unique<renderer::MapRenderer>(catalogue_, reader_.GetMapSettings());
+        }
+        return *renderer_;
+    }
 
-        json::Array result;
-        for (const auto& req : reader_.GetStatRequests()) {
-            const auto& m = req.AsDict();
-            const std::string& type = m.at("type").AsString();
-            int id = m.at("id").AsInt();
+    bool RequestHandler::ApplyUpdate(const std::string& type, const json::Dict& request) const {
+        if (type == "AddBus") {
+            const std::string& bus_name = request.at("name").AsString();
+            std::vector<std::string_view> stops;
+            for (const auto& node : request.at("stops").AsArray()) {
+                if (!catalogue_.FindStop(node.AsString())) {
+                    return false;
+                }
+                stops.push_back(node.AsString());
+            }
+            catalogue_.AddBus(bus_name, stops, request.at("is_roundtrip").AsBool());
+            catalogue_.Freeze();
+            if (router_) {
+                router_->AddBus(catalogue_, bus_name);
+            }
+        } else if (type == "RemoveBus") {
+            const std::string& bus_name = request.at("name").AsString();
+            if (!catalogue_.FindBus(bus_name)) {
+                return false;
+            }
+            catalogue_.RemoveBus(bus_name);
+            catalogue_.Freeze();
+            if (router_) {
+                router_->RemoveBus(catalogue_, bus_name);
+            }
+        } else {
+            const std::string& from = request.at("from").AsString();
+            const std::string& to = request.at("to").AsString();
+            if (!catalogue_.FindStop(from) || !catalogue_.FindStop(to)) {
+                return false;
+            }
+            catalogue_.SetDistance(from, to, request.at("distance").AsInt());
+            if (router_) {
+                router_->UpdateDistance(catalogue_, from, to);
+            }
+        }
+        // Debug builds check every update against a router built from scratch.
+        assert(!router_ || router_->MatchesRebuild(catalogue_));
+        renderer_.reset();
+        return true;
+    }
 
-            if (type == "Map") {
-                svg::Document doc = renderer.Render();
-                std::ostringstream svg_out;
-                doc.Render(svg_out);
-                result.emplace_back(json::Dict{
+    void RequestHandler::ProcessRequests(std::ostream& output) const {
+        json::ArrayWriter writer(output, RESPONSES_PER_FLUSH);
+        for (const auto& request : reader_.GetStatRequests()) {
+            if (auto response = ProcessRequest(request)) {
+                writer.Write(*response);
+            }
+        }
+        writer.Close();
+    }
+
+    std::optional<json::Node> RequestHandler::ProcessRequest(const json::Node& request) const {
+        const auto& m = request.AsDict();
+        const std::string& type = m.at("type").AsString();
+        int id = m.at("id").AsInt();
+
+        if (type == "Map") {
+            svg::Document doc = GetRenderer().Render();
+            std::ostringstream svg_out;
+            doc.Render(svg_out);
+            return json::Dict{
+                {"request_id", id},
+                {"map", svg_out.str()}
+            };
+        } else if (type == "Stop") {
+            const std::string& stop_name = m.at("name").AsString();
+            auto buses_opt = catalogue_.GetBusesByStop(stop_name);
+            if (!buses_opt) {
+                return json::Dict{
                     {"request_id", id},
-                    {"map", svg_out.str()}
-                });
-            } else if (type == "Stop") {
-                const std::string& stop_name = m.at("name").AsString();
-                auto buses_opt = catalogue_.GetBusesByStop(stop_name);
-                if (!buses_opt) {
-                    result.emplace_back(json::Dict{
-                        {"request_id", id},
-                        {"error_message", "not found"}
-                    });
-                } else {
-                    json::Array arr;
-                    for (const auto& bus : *buses_opt) {
-                        arr.emplace_back(std::string(bus));
-                    }
-                    result.emplace_back(json::Dict{
-                        {"request_id", id},
-                        {"buses", arr}
-                    });
+                    {"error_message", "not found"}
+                };
+            } else {
+                json::Array arr;
+                for (const auto bus : *buses_opt) {
+                    arr.emplace_back(std::string(catalogue_.GetBusName(bus)));
                 }
-            } else if (type == "Bus") {
-                const std::string& bus_name = m.at("name").AsString();
-                auto info_opt = catalogue_.GetBusInfo(bus_name);
-                if (!info_opt) {
-                    result.emplace_back(json::Dict{
-                        {"request_id", id},
-                        {"error_message", "not found"}
-                    });
-                } else {
-                    const auto& info = *info_opt;
-                    result.emplace_back(json::Dict{
-                        {"request_id", id},
-                        {"route_length", info.route_length},
-                        {"curvature", info.curvature},
-                        {"stop_count", static_cast<int>(info.stop_count)},
-                        {"unique_stop_count", static_cast<int>(info.unique_stop_count)}
-                    });
-                }
-            } else if (type == "Route") {
-                std::string from = m.at("from").AsString();
-                std::string to = m.at("to").AsString();
-
-                auto route_opt = router.BuildRoute(from, to);
-                if (!route_opt) {
-                    result.emplace_back(json::Dict{
-                        {"request_id", id},
-                        {"error_message", "not found"}
-                    });
-                } else {
-                    const auto& route = *route_opt;
-                    json::Array items_array;
+                return json::Dict{
+                    {"request_id", id},
+                    {"buses", arr}
+                };
+            }
+        } else if (type == "Bus") {
+            const std::string& bus_name = m.at("name").AsString();
+            auto info_opt = catalogue_.GetBusInfo(bus_name);
+            if (!info_opt) {
+                return json::Dict{
+                    {"request_id", id},
+                    {"error_message", "not found"}
+                };
+            } else {
+                const auto& info = *info_opt;
+                return json::Dict{
+                    {"request_id", id},
+                    {"route_length", info.route_length},
+                    {"curvature", info.curvature},
+                    {"stop_count", static_cast<int>(info.stop_count)},
+                    {"unique_stop_count", static_cast<int>(info.unique_stop_count)}
+                };
+            }
+        } else if (type == "Matrix") {
+            std::vector<std::string_view> origins;
+            for (const auto& node : m.at("from").AsArray()) {
+                origins.push_back(node.AsString());
+            }
+            std::vector<std::string_view> destinations;
+            for (const auto& node : m.at("to").AsArray()) {
+                destinations.push_back(node.AsString());
+            }
 
-                    for (const auto& item : route.items) {
-                        std::visit([&](const auto& v) {
-                            using T = std::decay_t<decltype(v)>;
-                            if constexpr (std::is_same_v<T, transport_router::WaitItem>) {
-                                items_array.emplace_back(json::Dict{
-                                    {"type", "Wait"},
-                                    {"stop_name", v.stop_name},
-                                    {"time", v.time}
-                                });
-                            } else if constexpr (std::is_same_v<T, transport_router::BusItem>) {
-                                items_array.emplace_back(json::Dict{
-                                    {"type", "Bus"},
-                                    {"bus", v.bus},
-                                    {"span_count", v.span_count},
-                                    {"time", v.time}
-                                });
-                            }
-                        }, item);
+            auto matrix_opt = GetRouter().BuildTravelTimeMatrix(origins, destinations);
+            if (!matrix_opt) {
+                return json::Dict{
+                    {"request_id", id},
+                    {"error_message", "not found"}
+                };
+            } else {
+                json::Array rows;
+                for (const auto& row : *matrix_opt) {
+                    json::Array cells;
+                    for (const auto& time : row) {
+                        cells.emplace_back(time ? json::Node(*time) : json::Node(nullptr));
                     }
+                    rows.emplace_back(std::move(cells));
+                }
+                return json::Dict{
+                    {"request_id", id},
+                    {"times", rows}
+                };
+            }
+        } else if (type == "AddBus" || type == "RemoveBus" || type == "SetDistance") {
+            if (!ApplyUpdate(type, m)) {
+                return json::Dict{
+                    {"request_id", id},
+                    {"error_message", "not found"}
+                };
+            }
+            return json::Dict{
+                {"request_id", id}
+            };
+        } else if (type == "Stats") {
+            // Bytes held by the stop and bus names, blocks' unused tails included.
+            return json::Dict{
+                {"request_id", id},
+                {"names_memory_usage", static_cast<int>(catalogue_.GetNamesMemoryUsage())}
+            };
+        } else if (type == "Route") {
+            std::string from = m.at("from").AsString();
+            std::string to = m.at("to").AsString();
 
-                    result.emplace_back(json::Dict{
-                        {"request_id", id},
-                        {"total_time", route.total_time},
-                        {"items", items_array}
-                    });
+            auto route_opt = GetRouter().BuildRoute(from, to);
+            if (!route_opt) {
+                return json::Dict{
+                    {"request_id", id},
+                    {"error_message", "not found"}
+                };
+            } else {
+                const auto& route = *route_opt;
+                json::Array items_array;
+
+                for (const auto& item : route.items) {
+                    std::visit([&](const auto& v) {
+                        using T = std::decay_t<decltype(v)>;
+                        if constexpr (std::is_same_v<T, transport_router::WaitItem>) {
+                            items_array.emplace_back(json::Dict{
+                                {"type", "Wait"},
+                                {"stop_name", std::string(v.stop_name)},
+                                {"time", v.time}
+                            });
+                        } else if constexpr (std::is_same_v<T, transport_router::BusItem>) {
+                            items_array.emplace_back(json::Dict{
+                                {"type", "Bus"},
+                                {"bus", std::string(v.bus)},
+                                {"span_count", v.span_count},
+                                {"time", v.time}
+                            });
+                        }
+                    }, item);
                 }
+
+                return json::Dict{
+                    {"request_id", id},
+                    {"total_time", route.total_time},
+                    {"items", items_array}
+                };
             }
         }
 
-        return result;
+        return std::nullopt;
     }
 }
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
 #include <vector>
 #include "transport_catalogue.h"
 #include "json.h"
@@ -16,11 +20,29 @@ namespace transport_catalogue::readers {
 
         void ApplyCommands() const;
 
-        [[nodiscard]] json::Array ProcessRequests() const;
+        // Writes the responses to the stat requests as a JSON array, each one as soon as it is ready.
+        void ProcessRequests(std::ostream &output) const;
 
     private:
+        static constexpr size_t RESPONSES_PER_FLUSH = 64;
+
+        // std::nullopt for a request of an unknown type, which gets no response.
+        std::optional<json::Node> ProcessRequest(const json::Node &request) const;
+
+        // AddBus, RemoveBus and SetDistance requests change the catalogue between queries; a
+        // router that is already built is updated in place. False if a name is unknown.
+        bool ApplyUpdate(const std::string &type, const json::Dict &request) const;
+
+        // Built on the first request that needs them and kept for later batches until the
+        // input changes. Update requests repair the router and drop the renderer.
+        const transport_router::TransportRouter &GetRouter() const;
+
+        const renderer::MapRenderer &GetRenderer() const;
+
         transport_router::RoutingSettings route_settings_;
         TransportCatalogue &catalogue_;
         JsonReader reader_;
+        mutable std::unique_ptr<transport_router::TransportRouter> router_;
+        mutable std::unique_ptr<renderer::MapRenderer> renderer_;
     };
 }
@@ -3,17 +3,60 @@
 #include "graph.h"
 
 #include <algorithm>
+#include <barrier>
 #include <cassert>
 #include <cstdint>
+#include <functional>
 #include <iterator>
+#include <limits>
 #include <optional>
+#include <queue>
+#include <span>
 #include <stdexcept>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace graph {
 
+// Dijkstra from one source: calls on_settled(vertex, weight, last_edge) once for every
+// reachable vertex, the source included with no last edge. The all-pairs routers use it
+// to recompute single rows of their tables.
+template <typename Weight, typename OnSettled>
+void ForEachShortestRoute(const DirectedWeightedGraph<Weight>& graph, VertexId source, OnSettled on_settled) {
+    constexpr EdgeId no_edge = std::numeric_limits<EdgeId>::max();
+    std::vector<Weight> weights(graph.GetVertexCount(), Weight{});
+    std::vector<EdgeId> prev_edges(graph.GetVertexCount(), no_edge);
+    std::vector<bool> settled(graph.GetVertexCount(), false);
+
+    using QueueItem = std::pair<Weight, VertexId>;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+    queue.emplace(Weight{}, source);
+    while (!queue.empty()) {
+        const VertexId vertex = queue.top().second;
+        queue.pop();
+        if (settled[vertex]) {
+            continue;
+        }
+        settled[vertex] = true;
+        on_settled(vertex, weights[vertex],
+                   prev_edges[vertex] != no_edge ? std::optional<EdgeId>(prev_edges[vertex]) : std::nullopt);
+
+        const auto edges = graph.GetOutgoingEdgeSlice(vertex);
+        for (size_t i = 0; i < edges.size(); ++i) {
+            const VertexId next = edges.vertices[i];
+            const Weight candidate_weight = weights[vertex] + edges.weights[i];
+            const bool is_reached = next == source || prev_edges[next] != no_edge;
+            if (!settled[next] && (!is_reached || candidate_weight < weights[next])) {
+                weights[next] = candidate_weight;
+                prev_edges[next] = edges.edge_ids[i];
+                queue.emplace(candidate_weight, next);
+            }
+        }
+    }
+}
+
 template <typename Weight>
 class Router {
 private:
@@ -29,6 +72,12 @@ public:
 
     std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
+    // Repairs the table after the graph changed. Rows whose routes go through an
+    // invalidated (removed or reweighted) edge are recomputed from scratch; then the
+    // relaxing (added or cheaper) edges are propagated through their tail vertices, which
+    // costs O(V^2) per distinct tail instead of the O(V^3) full precompute.
+    void Update(const std::vector<EdgeId>& invalidated_edges, const std::vector<EdgeId>& relaxing_edges);
+
 private:
     struct RouteInternalData {
         Weight weight;
@@ -40,14 +89,14 @@ private:
         const size_t vertex_count = graph.GetVertexCount();
         for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
             routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
-            for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
-                const auto& edge = graph.GetEdge(edge_id);
-                if (edge.weight < ZERO_WEIGHT) {
+            const auto edges = graph.GetOutgoingEdgeSlice(vertex);
+            for (size_t i = 0; i < edges.size(); ++i) {
+                if (edges.weights[i] < ZERO_WEIGHT) {
                     throw std::domain_error("Edges' weights should be non-negative");
                 }
-                auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                    route_internal_data = RouteInternalData{edge.weight, edge_id};
+                auto& route_internal_data = routes_internal_data_[vertex][edges.vertices[i]];
+                if (!route_internal_data || route_internal_data->weight > edges.weights[i]) {
+                    route_internal_data = RouteInternalData{edges.weights[i], edges.edge_ids[i]};
                 }
             }
         }
@@ -94,6 +143,52 @@ Router<Weight>::Router(const Graph& graph)
     }
 }
 
+template <typename Weight>
+void Router<Weight>::Update(const std::vector<EdgeId>& invalidated_edges,
+                            const std::vector<EdgeId>& relaxing_edges) {
+    const size_t vertex_count = graph_.GetVertexCount();
+    std::vector<bool> is_invalidated(graph_.GetEdgeCount(), false);
+    for (const EdgeId edge_id : invalidated_edges) {
+        is_invalidated[edge_id] = true;
+    }
+    for (auto& row : routes_internal_data_) {
+        const bool uses_invalidated_edge = std::any_of(row.begin(), row.end(), [&](const auto& route) {
+            return route && route->prev_edge && is_invalidated[*route->prev_edge];
+        });
+        if (!uses_invalidated_edge) {
+            continue;
+        }
+        const VertexId source = &row - routes_internal_data_.data();
+        row.assign(vertex_count, std::nullopt);
+        ForEachShortestRoute(graph_, source, [&row](VertexId vertex, Weight weight, std::optional<EdgeId> prev_edge) {
+            row[vertex] = RouteInternalData{weight, prev_edge};
+        });
+    }
+
+    std::vector<VertexId> tails;
+    for (const EdgeId edge_id : relaxing_edges) {
+        if (graph_.IsEdgeRemoved(edge_id)) {
+            continue;
+        }
+        const auto& edge = graph_.GetEdge(edge_id);
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        const RouteInternalData route_from{edge.weight, edge_id};
+        for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
+            if (const auto& route_to = routes_internal_data_[edge.to][vertex_to]) {
+                RelaxRoute(edge.from, vertex_to, route_from, *route_to);
+            }
+        }
+        tails.push_back(edge.from);
+    }
+    std::sort(tails.begin(), tails.end());
+    tails.erase(std::unique(tails.begin(), tails.end()), tails.end());
+    for (const VertexId vertex_through : tails) {
+        RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+    }
+}
+
 template <typename Weight>
 std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
                                                                              VertexId to) const {
@@ -114,4 +209,314 @@ std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(Ver
     return RouteInfo{weight, std::move(edges)};
 }
 
-}
\ No newline at end of file
+// Same Floyd-Warshall precompute as Router, but the table is stored as one contiguous
+// row-major V x V weight matrix plus a packed 32-bit predecessor matrix. Unreachable
+// cells and missing predecessors are encoded with sentinels instead of std::optional,
+// so a cell takes sizeof(Weight) + 4 bytes and the relaxation loop is branch-free.
+template <typename Weight>
+class FlatRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using PackedEdgeId = uint32_t;
+
+    static constexpr size_t TILE_SIZE = 64;
+
+    explicit FlatRouter(const Graph& graph, size_t thread_count = 1);
+
+    // Serves routes from a table computed earlier for the same graph, e.g. one mapped from
+    // a file, without copying it. The table must outlive the router.
+    FlatRouter(const Graph& graph, std::span<const Weight> weights, std::span<const PackedEdgeId> prev_edges);
+
+    using RouteInfo = typename Router<Weight>::RouteInfo;
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    // Same repair as Router::Update. A table viewed from external storage is copied into
+    // the router first.
+    void Update(const std::vector<EdgeId>& invalidated_edges, const std::vector<EdgeId>& relaxing_edges);
+
+    std::span<const Weight> GetWeights() const {
+        return table_weights_;
+    }
+
+    std::span<const PackedEdgeId> GetPrevEdges() const {
+        return table_prev_edges_;
+    }
+
+private:
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight UNREACHABLE = std::numeric_limits<Weight>::has_infinity
+                                              ? std::numeric_limits<Weight>::infinity()
+                                              : std::numeric_limits<Weight>::max();
+    static constexpr PackedEdgeId NO_EDGE = std::numeric_limits<PackedEdgeId>::max();
+
+    size_t CellIndex(VertexId from, VertexId to) const {
+        return from * vertex_count_ + to;
+    }
+
+    void InitializeRoutesInternalData(const Graph& graph) {
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            weights_[CellIndex(vertex, vertex)] = ZERO_WEIGHT;
+            const auto edges = graph.GetOutgoingEdgeSlice(vertex);
+            for (size_t i = 0; i < edges.size(); ++i) {
+                if (edges.weights[i] < ZERO_WEIGHT) {
+                    throw std::domain_error("Edges' weights should be non-negative");
+                }
+                if (edges.edge_ids[i] >= NO_EDGE) {
+                    throw std::length_error("Too many edges for a packed routing table");
+                }
+                const size_t cell = CellIndex(vertex, edges.vertices[i]);
+                if (weights_[cell] > edges.weights[i]) {
+                    weights_[cell] = edges.weights[i];
+                    prev_edges_[cell] = static_cast<PackedEdgeId>(edges.edge_ids[i]);
+                }
+            }
+        }
+    }
+
+    void RelaxRowSegment(VertexId vertex_from, Weight weight_from, PackedEdgeId prev_edge_from,
+                         const Weight* weights_through, const PackedEdgeId* prev_edges_through,
+                         VertexId column_begin, VertexId column_end) {
+        Weight* const weights_relaxing = &weights_[CellIndex(vertex_from, 0)];
+        PackedEdgeId* const prev_edges_relaxing = &prev_edges_[CellIndex(vertex_from, 0)];
+        for (VertexId vertex_to = column_begin; vertex_to < column_end; ++vertex_to) {
+            const Weight candidate_weight = weight_from + weights_through[vertex_to];
+            bool is_better = candidate_weight < weights_relaxing[vertex_to];
+            if constexpr (!std::numeric_limits<Weight>::has_infinity) {
+                is_better = is_better && weights_through[vertex_to] != UNREACHABLE;
+            }
+            const PackedEdgeId prev_edge_to = prev_edges_through[vertex_to];
+            const PackedEdgeId candidate_prev_edge = prev_edge_to != NO_EDGE ? prev_edge_to : prev_edge_from;
+            weights_relaxing[vertex_to] = is_better ? candidate_weight : weights_relaxing[vertex_to];
+            prev_edges_relaxing[vertex_to] = is_better ? candidate_prev_edge : prev_edges_relaxing[vertex_to];
+        }
+    }
+
+    void RelaxRoutesInternalDataThroughVertex(VertexId vertex_through) {
+        const Weight* const weights_through = &weights_[CellIndex(vertex_through, 0)];
+        const PackedEdgeId* const prev_edges_through = &prev_edges_[CellIndex(vertex_through, 0)];
+        for (VertexId vertex_from = 0; vertex_from < vertex_count_; ++vertex_from) {
+            const Weight weight_from = weights_[CellIndex(vertex_from, vertex_through)];
+            if (weight_from == UNREACHABLE) {
+                continue;
+            }
+            RelaxRowSegment(vertex_from, weight_from, prev_edges_[CellIndex(vertex_from, vertex_through)],
+                            weights_through, prev_edges_through, 0, vertex_count_);
+        }
+    }
+
+    // Values of the pivot rows and columns of one tiled round, captured at the moment each
+    // pivot vertex is processed. They let every tile replay exactly the relaxations the
+    // sequential loop performs, so the parallel table is bit-identical to the sequential one.
+    struct PivotSnapshot {
+        std::vector<Weight> row_weights;
+        std::vector<PackedEdgeId> row_prev_edges;
+        std::vector<Weight> column_weights;
+        std::vector<PackedEdgeId> column_prev_edges;
+    };
+
+    void RelaxTile(size_t round, size_t tile_row, size_t tile_column, PivotSnapshot& pivot) {
+        const VertexId through_begin = round * TILE_SIZE;
+        const VertexId through_end = std::min(through_begin + TILE_SIZE, vertex_count_);
+        const VertexId row_begin = tile_row * TILE_SIZE;
+        const VertexId row_end = std::min(row_begin + TILE_SIZE, vertex_count_);
+        const VertexId column_begin = tile_column * TILE_SIZE;
+        const VertexId column_end = std::min(column_begin + TILE_SIZE, vertex_count_);
+
+        for (VertexId vertex_through = through_begin; vertex_through < through_end; ++vertex_through) {
+            const size_t pivot_index = vertex_through - through_begin;
+            Weight* const pivot_row_weights = &pivot.row_weights[pivot_index * vertex_count_];
+            PackedEdgeId* const pivot_row_prev_edges = &pivot.row_prev_edges[pivot_index * vertex_count_];
+            if (tile_row == round) {
+                std::copy(&weights_[CellIndex(vertex_through, column_begin)],
+                          &weights_[CellIndex(vertex_through, column_end)], pivot_row_weights + column_begin);
+                std::copy(&prev_edges_[CellIndex(vertex_through, column_begin)],
+                          &prev_edges_[CellIndex(vertex_through, column_end)], pivot_row_prev_edges + column_begin);
+            }
+            if (tile_column == round) {
+                for (VertexId vertex_from = row_begin; vertex_from < row_end; ++vertex_from) {
+                    pivot.column_weights[vertex_from * TILE_SIZE + pivot_index] =
+                        weights_[CellIndex(vertex_from, vertex_through)];
+                    pivot.column_prev_edges[vertex_from * TILE_SIZE + pivot_index] =
+                        prev_edges_[CellIndex(vertex_from, vertex_through)];
+                }
+            }
+            for (VertexId vertex_from = row_begin; vertex_from < row_end; ++vertex_from) {
+                const Weight weight_from = pivot.column_weights[vertex_from * TILE_SIZE + pivot_index];
+                if (weight_from == UNREACHABLE) {
+                    continue;
+                }
+                RelaxRowSegment(vertex_from, weight_from, pivot.column_prev_edges[vertex_from * TILE_SIZE + pivot_index],
+                                pivot_row_weights, pivot_row_prev_edges, column_begin, column_end);
+            }
+        }
+    }
+
+    // Blocked Floyd-Warshall: each round relaxes the diagonal tile first, then the tiles of
+    // the pivot row and column, then all remaining tiles; the last two stages run in parallel.
+    void RelaxRoutesInternalDataInParallel(size_t thread_count) {
+        const size_t tile_count = (vertex_count_ + TILE_SIZE - 1) / TILE_SIZE;
+        PivotSnapshot pivot{std::vector<Weight>(TILE_SIZE * vertex_count_),
+                            std::vector<PackedEdgeId>(TILE_SIZE * vertex_count_),
+                            std::vector<Weight>(vertex_count_ * TILE_SIZE),
+                            std::vector<PackedEdgeId>(vertex_count_ * TILE_SIZE)};
+        std::barrier sync_point(static_cast<std::ptrdiff_t>(thread_count));
+
+        auto worker = [&](size_t thread_index) {
+            for (size_t round = 0; round < tile_count; ++round) {
+                if (thread_index == 0) {
+                    RelaxTile(round, round, round, pivot);
+                }
+                sync_point.arrive_and_wait();
+
+                for (size_t tile = thread_index; tile < tile_count; tile += thread_count) {
+                    if (tile != round) {
+                        RelaxTile(round, round, tile, pivot);
+                        RelaxTile(round, tile, round, pivot);
+                    }
+                }
+                sync_point.arrive_and_wait();
+
+                for (size_t tile = thread_index; tile < tile_count * tile_count; tile += thread_count) {
+                    const size_t tile_row = tile / tile_count;
+                    const size_t tile_column = tile % tile_count;
+                    if (tile_row != round && tile_column != round) {
+                        RelaxTile(round, tile_row, tile_column, pivot);
+                    }
+                }
+                sync_point.arrive_and_wait();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count - 1);
+        for (size_t thread_index = 1; thread_index < thread_count; ++thread_index) {
+            threads.emplace_back(worker, thread_index);
+        }
+        worker(0);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    const Graph& graph_;
+    size_t vertex_count_;
+    std::vector<Weight> weights_;
+    std::vector<PackedEdgeId> prev_edges_;
+    std::span<const Weight> table_weights_;
+    std::span<const PackedEdgeId> table_prev_edges_;
+};
+
+template <typename Weight>
+FlatRouter<Weight>::FlatRouter(const Graph& graph, size_t thread_count)
+    : graph_(graph)
+    , vertex_count_(graph.GetVertexCount())
+    , weights_(vertex_count_ * vertex_count_, UNREACHABLE)
+    , prev_edges_(vertex_count_ * vertex_count_, NO_EDGE)
+{
+    InitializeRoutesInternalData(graph);
+
+    if (thread_count > 1 && vertex_count_ > TILE_SIZE) {
+        RelaxRoutesInternalDataInParallel(thread_count);
+    } else {
+        for (VertexId vertex_through = 0; vertex_through < vertex_count_; ++vertex_through) {
+            RelaxRoutesInternalDataThroughVertex(vertex_through);
+        }
+    }
+    table_weights_ = weights_;
+    table_prev_edges_ = prev_edges_;
+}
+
+template <typename Weight>
+FlatRouter<Weight>::FlatRouter(const Graph& graph, std::span<const Weight> weights,
+                               std::span<const PackedEdgeId> prev_edges)
+    : graph_(graph)
+    , vertex_count_(graph.GetVertexCount())
+    , table_weights_(weights)
+    , table_prev_edges_(prev_edges)
+{
+    if (weights.size() != vertex_count_ * vertex_count_ || prev_edges.size() != vertex_count_ * vertex_count_) {
+        throw std::invalid_argument("Routing table does not match the graph");
+    }
+}
+
+template <typename Weight>
+void FlatRouter<Weight>::Update(const std::vector<EdgeId>& invalidated_edges,
+                                const std::vector<EdgeId>& relaxing_edges) {
+    if (table_weights_.data() != weights_.data()) {
+        weights_.assign(table_weights_.begin(), table_weights_.end());
+        prev_edges_.assign(table_prev_edges_.begin(), table_prev_edges_.end());
+        table_weights_ = weights_;
+        table_prev_edges_ = prev_edges_;
+    }
+
+    std::vector<bool> is_invalidated(graph_.GetEdgeCount(), false);
+    for (const EdgeId edge_id : invalidated_edges) {
+        is_invalidated[edge_id] = true;
+    }
+    for (VertexId source = 0; source < vertex_count_; ++source) {
+        Weight* const row_weights = &weights_[CellIndex(source, 0)];
+        PackedEdgeId* const row_prev_edges = &prev_edges_[CellIndex(source, 0)];
+        const bool uses_invalidated_edge = std::any_of(row_prev_edges, row_prev_edges + vertex_count_,
+                                                       [&](PackedEdgeId edge_id) {
+            return edge_id != NO_EDGE && is_invalidated[edge_id];
+        });
+        if (!uses_invalidated_edge) {
+            continue;
+        }
+        std::fill(row_weights, row_weights + vertex_count_, UNREACHABLE);
+        std::fill(row_prev_edges, row_prev_edges + vertex_count_, NO_EDGE);
+        ForEachShortestRoute(graph_, source, [&](VertexId vertex, Weight weight, std::optional<EdgeId> prev_edge) {
+            row_weights[vertex] = weight;
+            row_prev_edges[vertex] = prev_edge ? static_cast<PackedEdgeId>(*prev_edge) : NO_EDGE;
+        });
+    }
+
+    std::vector<VertexId> tails;
+    for (const EdgeId edge_id : relaxing_edges) {
+        if (graph_.IsEdgeRemoved(edge_id)) {
+            continue;
+        }
+        const auto& edge = graph_.GetEdge(edge_id);
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        if (edge_id >= NO_EDGE) {
+            throw std::length_error("Too many edges for a packed routing table");
+        }
+        RelaxRowSegment(edge.from, edge.weight, static_cast<PackedEdgeId>(edge_id),
+                        &weights_[CellIndex(edge.to, 0)], &prev_edges_[CellIndex(edge.to, 0)], 0, vertex_count_);
+        tails.push_back(edge.from);
+    }
+    std::sort(tails.begin(), tails.end());
+    tails.erase(std::unique(tails.begin(), tails.end()), tails.end());
+    for (const VertexId vertex_through : tails) {
+        RelaxRoutesInternalDataThroughVertex(vertex_through);
+    }
+}
+
+template <typename Weight>
+std::optional<typename FlatRouter<Weight>::RouteInfo> FlatRouter<Weight>::BuildRoute(VertexId from,
+                                                                                     VertexId to) const {
+    if (from >= vertex_count_ || to >= vertex_count_) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    const Weight weight = table_weights_[CellIndex(from, to)];
+    if (weight == UNREACHABLE) {
+        return std::nullopt;
+    }
+    std::vector<EdgeId> edges;
+    for (PackedEdgeId edge_id = table_prev_edges_[CellIndex(from, to)];
+         edge_id != NO_EDGE;
+         edge_id = table_prev_edges_[CellIndex(from, graph_.GetEdge(edge_id).from)])
+    {
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{weight, std::move(edges)};
+}
+
+}
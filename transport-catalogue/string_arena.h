@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace transport_catalogue {
+    // Bump allocator for strings that live as long as the arena. Strings are copied into large
+    // blocks and never move, so views into them stay valid; nothing is freed until the arena
+    // is destroyed, which releases a few blocks instead of one allocation per string.
+    class StringArena {
+    public:
+        static constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+        explicit StringArena(size_t block_size = DEFAULT_BLOCK_SIZE)
+            : block_size_(block_size) {
+        }
+
+        StringArena(const StringArena &) = delete;
+        StringArena &operator=(const StringArena &) = delete;
+
+        std::string_view Store(std::string_view text) {
+            if (text.empty()) {
+                return {};
+            }
+            if (text.size() > remaining_) {
+                // A string longer than half a block gets a block of its own; the current block
+                // keeps its free space for the strings that follow.
+                if (text.size() > block_size_ / 2) {
+                    char *data = AllocateBlock(text.size());
+                    return Copy(data, text);
+                }
+                current_ = AllocateBlock(block_size_);
+                remaining_ = block_size_;
+            }
+            const std::string_view stored = Copy(current_, text);
+            current_ += text.size();
+            remaining_ -= text.size();
+            return stored;
+        }
+
+        // Whether a non-empty text lies within the arena's blocks, so a view of it stays valid
+        // as long as the arena.
+        bool Contains(std::string_view text) const {
+            if (text.empty()) {
+                return false;
+            }
+            const std::less<const char *> less;
+            // The last block that starts at or before the text.
+            auto it = std::upper_bound(blocks_.begin(), blocks_.end(), text.data(),
+                                       [&less](const char *data, const Block &block) {
+                                           return less(data, block.data.get());
+                                       });
+            if (it == blocks_.begin()) {
+                return false;
+            }
+            --it;
+            return !less(it->data.get() + it->size, text.data() + text.size());
+        }
+
+        // Bytes of the stored strings.
+        size_t GetUsedBytes() const {
+            return used_bytes_;
+        }
+
+        // Bytes allocated for the blocks, including their unused tails.
+        size_t GetAllocatedBytes() const {
+            return allocated_bytes_;
+        }
+
+    private:
+        struct Block {
+            std::unique_ptr<char[]> data;
+            size_t size;
+        };
+
+        char *AllocateBlock(size_t size) {
+            Block block{std::make_unique_for_overwrite<char[]>(std::max<size_t>(size, 1)), size};
+            char *data = block.data.get();
+            // Blocks are kept in address order for Contains.
+            const auto it = std::upper_bound(blocks_.begin(), blocks_.end(), data,
+                                             [](const char *lhs, const Block &rhs) {
+                                                 return std::less<const char *>()(lhs, rhs.data.get());
+                                             });
+            blocks_.insert(it, std::move(block));
+            allocated_bytes_ += size;
+            return data;
+        }
+
+        std::string_view Copy(char *data, std::string_view text) {
+            std::memcpy(data, text.data(), text.size());
+            used_bytes_ += text.size();
+            return {data, text.size()};
+        }
+
+        size_t block_size_;
+        std::vector<Block> blocks_;
+        char *current_ = nullptr;
+        size_t remaining_ = 0;
+        size_t used_bytes_ = 0;
+        size_t allocated_bytes_ = 0;
+    };
+}
@@ -1,147 +1,286 @@
 #include "transport_catalogue.h"
+#include "content_hash.h"
 #include <algorithm>
+#include <limits>
+#include <tuple>
 #include <stdexcept>
-#include <unordered_set>
 
 namespace transport_catalogue {
     void TransportCatalogue::AddStop(std::string_view name, const geo::Coordinates &coordinates) {
-        auto &stored_name = stops_storage_.emplace_back(name);
-        all_stops_[stored_name] = domain::Stop{
-            .name = stored_name,
-            .coordinates = coordinates
-        };
+        if (const auto stop = FindStop(name)) {
+            stop_trig_coordinates_[*stop] = geo::ToTrigCoordinates(coordinates);
+            UpdateBusStatsAtStop(*stop);
+            return;
+        }
+        const std::string_view stored_name = KeepName(name);
+        stop_ids_.emplace(stored_name, static_cast<domain::StopId>(stop_names_.size()));
+        stop_names_.push_back(stored_name);
+        stop_trig_coordinates_.push_back(geo::ToTrigCoordinates(coordinates));
+        frozen_ = false;
     }
 
     void TransportCatalogue::AddBus(std::string_view bus_name, const std::vector<std::string_view> &stops_names, bool is_roundtrip) {
-        auto &stored_bus_name = buses_storage_.emplace_back(bus_name);
+        std::vector<domain::StopId> stops;
+        stops.reserve(is_roundtrip ? stops_names.size() : stops_names.size() * 2);
+        for (auto stop_name: stops_names) {
+            const auto stop = FindStop(stop_name);
+            if (!stop) {
+                throw std::runtime_error("Stop not found: " + std::string(stop_name));
+            }
+            stops.push_back(*stop);
+        }
 
-        domain::Bus bus;
-        bus.name = stored_bus_name;
-        bus.is_roundtrip = is_roundtrip;
-        std::vector<const domain::Stop *> stops_ptrs;
-        stops_ptrs.reserve(stops_names.size());
+        if (!is_roundtrip && stops.size() > 1) {
+            for (size_t i = stops.size() - 1; i-- > 0;) {
+                stops.push_back(stops[i]);
+            }
+        }
 
-        for (auto stop_name: stops_names) {
-            std::string stop_name_copy(stop_name);
-            const domain::Stop *stop_ptr = FindStop(stop_name_copy);
-            if (!stop_ptr) {
-                throw std::runtime_error("Stop not found: " + stop_name_copy);
+        domain::BusId bus;
+        if (const auto existing = FindBus(bus_name)) {
+            bus = *existing;
+        } else {
+            bus = static_cast<domain::BusId>(bus_names_.size());
+            const std::string_view stored_bus_name = KeepName(bus_name);
+            bus_ids_.emplace(stored_bus_name, bus);
+            bus_names_.push_back(stored_bus_name);
+            bus_stops_.emplace_back();
+            bus_is_roundtrip_.push_back(false);
+            bus_road_distances_.emplace_back();
+            bus_geo_distances_.emplace_back();
+            bus_infos_.emplace_back();
+        }
+
+        bus_stops_[bus] = std::move(stops);
+        bus_is_roundtrip_[bus] = is_roundtrip;
+        UpdateBusStats(bus);
+        frozen_ = false;
+    }
+
+    void TransportCatalogue::UpdateBusStats(domain::BusId bus) {
+        const std::vector<domain::StopId> &stops = bus_stops_[bus];
+        auto &road_distances = bus_road_distances_[bus];
+        auto &geo_distances = bus_geo_distances_[bus];
+        road_distances.assign(stops.size(), 0.0);
+        geo_distances.assign(stops.size(), 0.0);
+
+        std::vector<geo::TrigCoordinates> points;
+        points.reserve(stops.size());
+        for (const domain::StopId stop: stops) {
+            points.push_back(stop_trig_coordinates_[stop]);
+        }
+        std::vector<double> segment_geo_distances(stops.empty() ? 0 : stops.size() - 1);
+        geo::ComputeSegmentDistances(points, segment_geo_distances);
+
+        for (size_t i = 1; i < stops.size(); ++i) {
+            road_distances[i] = road_distances[i - 1] + GetDistance(stops[i - 1], stops[i]);
+            geo_distances[i] = geo_distances[i - 1] + segment_geo_distances[i - 1];
+        }
+
+        std::vector<domain::StopId> unique(stops.begin(), stops.end());
+        std::sort(unique.begin(), unique.end());
+
+        domain::BusInfo &info = bus_infos_[bus];
+        info.name = bus_names_[bus];
+        info.stop_count = stops.size();
+        info.unique_stop_count = std::unique(unique.begin(), unique.end()) - unique.begin();
+        const double geo_length = geo_distances.empty() ? 0.0 : geo_distances.back();
+        info.route_length = road_distances.empty() ? 0 : static_cast<int>(road_distances.back());
+        info.curvature = geo_length > 0 ? info.route_length / geo_length : 0.0;
+    }
+
+    void TransportCatalogue::UpdateBusStatsAtStop(domain::StopId stop) {
+        if (!frozen_) {
+            // Without the stop-to-buses index the buses are found by Freeze.
+            pending_stop_updates_.push_back({stop, bus_names_.size()});
+            return;
+        }
+        for (size_t i = stop_bus_offsets_[stop]; i < stop_bus_offsets_[stop + 1]; ++i) {
+            UpdateBusStats(stop_bus_ids_[i]);
+        }
+    }
+
+    void TransportCatalogue::RemoveBus(std::string_view bus_name) {
+        auto it = bus_ids_.find(bus_name);
+        if (it == bus_ids_.end()) {
+            throw std::invalid_argument("Unknown bus name in RemoveBus: " + std::string(bus_name));
+        }
+        const domain::BusId bus = it->second;
+        bus_stops_[bus].clear();
+        bus_road_distances_[bus].clear();
+        bus_geo_distances_[bus].clear();
+        bus_ids_.erase(it);
+        frozen_ = false;
+    }
+
+    void TransportCatalogue::Freeze() {
+        // Buses are visited in name order, so every stop's bus list comes out sorted.
+        const std::vector<domain::BusId> buses = GetAllBuses();
+        constexpr size_t NO_BUS_INDEX = std::numeric_limits<size_t>::max();
+        std::vector<size_t> last_bus_index(stop_names_.size(), NO_BUS_INDEX);
+
+        stop_bus_offsets_.assign(stop_names_.size() + 1, 0);
+        for (size_t i = 0; i < buses.size(); ++i) {
+            for (const domain::StopId stop: bus_stops_[buses[i]]) {
+                if (last_bus_index[stop] != i) {
+                    last_bus_index[stop] = i;
+                    ++stop_bus_offsets_[stop + 1];
+                }
             }
-            stops_to_buses_[stop_ptr].insert(stored_bus_name);
-            stops_ptrs.push_back(stop_ptr);
+        }
+        for (size_t stop = 0; stop < stop_names_.size(); ++stop) {
+            stop_bus_offsets_[stop + 1] += stop_bus_offsets_[stop];
         }
 
-        if (!is_roundtrip && stops_ptrs.size() > 1) {
-            std::vector<const domain::Stop *> back_path(stops_ptrs.begin(), stops_ptrs.end() - 1);
-            std::reverse(back_path.begin(), back_path.end());
-            stops_ptrs.insert(stops_ptrs.end(), back_path.begin(), back_path.end());
+        stop_bus_ids_.resize(stop_bus_offsets_.back());
+        std::vector<size_t> next_positions(stop_bus_offsets_.begin(), stop_bus_offsets_.end() - 1);
+        last_bus_index.assign(stop_names_.size(), NO_BUS_INDEX);
+        for (size_t i = 0; i < buses.size(); ++i) {
+            for (const domain::StopId stop: bus_stops_[buses[i]]) {
+                if (last_bus_index[stop] != i) {
+                    last_bus_index[stop] = i;
+                    stop_bus_ids_[next_positions[stop]++] = buses[i];
+                }
+            }
         }
+        frozen_ = true;
 
+        // A bus added after the stop changed already saw the change.
+        std::vector<bool> is_updated(bus_names_.size(), false);
+        for (const auto &[stop, bus_count]: pending_stop_updates_) {
+            for (size_t i = stop_bus_offsets_[stop]; i < stop_bus_offsets_[stop + 1]; ++i) {
+                const domain::BusId bus = stop_bus_ids_[i];
+                if (bus < bus_count && !is_updated[bus]) {
+                    is_updated[bus] = true;
+                    UpdateBusStats(bus);
+                }
+            }
+        }
+        pending_stop_updates_.clear();
+    }
 
-        bus.stops = std::move(stops_ptrs);
-        all_routes_[stored_bus_name] = std::move(bus);
+
+    std::vector<domain::BusId> TransportCatalogue::GetAllBuses() const {
+        std::vector<domain::BusId> buses;
+        buses.reserve(bus_ids_.size());
+        for (const auto &[name, bus]: bus_ids_) {
+            buses.push_back(bus);
+        }
+        std::sort(buses.begin(), buses.end(), [this](domain::BusId lhs, domain::BusId rhs) {
+            return bus_names_[lhs] < bus_names_[rhs];
+        });
+        return buses;
     }
 
 
     std::vector<std::string_view> TransportCatalogue::GetAllBusNames() const {
         std::vector<std::string_view> names;
-        names.reserve(all_routes_.size());
-        for (const auto &[name, _]: all_routes_) {
+        names.reserve(bus_ids_.size());
+        for (const auto &[name, _]: bus_ids_) {
             names.push_back(name);
         }
         std::sort(names.begin(), names.end());
         return names;
     }
 
-
-    std::vector<const domain::Stop *> TransportCatalogue::GetAllStops() const {
-        std::vector<const domain::Stop *> stops;
-        stops.reserve(all_stops_.size());
-        for (const auto &[name, stop]: all_stops_) {
-            stops.push_back(&stop);
-        }
-        return stops;
-    }
-
-    void TransportCatalogue::SetDistance(const std::string &from, const std::string &to, int distance) {
-        const domain::Stop *s_from = FindStop(from);
-        const domain::Stop *s_to = FindStop(to);
+    void TransportCatalogue::SetDistance(std::string_view from, std::string_view to, int distance) {
+        const auto s_from = FindStop(from);
+        const auto s_to = FindStop(to);
         if (!s_from || !s_to) {
             throw std::invalid_argument("Unknown stop name in SetDistance");
         }
-        distances_[{s_from, s_to}] = distance;
+        distances_.Set(*s_from, *s_to, distance);
+        // Every segment whose length this can change starts or ends at from.
+        UpdateBusStatsAtStop(*s_from);
     }
 
 
-    int TransportCatalogue::GetDistance(const domain::Stop *from, const domain::Stop *to) const {
-        if (auto it = distances_.find({from, to}); it != distances_.end()) {
-            return it->second;
-        }
-        if (auto it = distances_.find({to, from}); it != distances_.end()) {
-            return it->second;
+    int TransportCatalogue::GetDistance(domain::StopId from, domain::StopId to) const {
+        if (const auto distance = distances_.Find(from, to)) {
+            return *distance;
         }
 
-        return static_cast<int>(geo::ComputeDistance(from->coordinates, to->coordinates));
+        return static_cast<int>(geo::ComputeDistance(stop_trig_coordinates_[from], stop_trig_coordinates_[to]));
     }
 
 
-    const domain::Stop *TransportCatalogue::FindStop(std::string_view name) const noexcept {
-        if (auto it = all_stops_.find(name); it != all_stops_.end()) {
-            return &it->second;
+    std::optional<domain::StopId> TransportCatalogue::FindStop(std::string_view name) const noexcept {
+        if (auto it = stop_ids_.find(name); it != stop_ids_.end()) {
+            return it->second;
         }
-        return nullptr;
+        return std::nullopt;
     }
 
 
-    const domain::Bus *TransportCatalogue::FindBus(std::string_view name) const noexcept {
-        if (auto it = all_routes_.find(name); it != all_routes_.end()) {
-            return &it->second;
+    std::optional<domain::BusId> TransportCatalogue::FindBus(std::string_view name) const noexcept {
+        if (auto it = bus_ids_.find(name); it != bus_ids_.end()) {
+            return it->second;
         }
-        return nullptr;
+        return std::nullopt;
     }
 
-    std::optional<std::vector<std::string_view> >
+    std::optional<std::span<const domain::BusId> >
     TransportCatalogue::GetBusesByStop(std::string_view stop_name) const {
-        const domain::Stop *stop_ptr = FindStop(stop_name);
-        if (!stop_ptr) {
-            return std::nullopt;
+        if (!frozen_) {
+            throw std::logic_error("Catalogue must be frozen before stop queries");
         }
-
-        auto buses_it = stops_to_buses_.find(stop_ptr);
-        if (buses_it == stops_to_buses_.end() || buses_it->second.empty()) {
-            return std::vector<std::string_view>{};
+        const auto stop = FindStop(stop_name);
+        if (!stop) {
+            return std::nullopt;
         }
-
-        std::vector<std::string_view> buses(buses_it->second.begin(), buses_it->second.end());
-        std::sort(buses.begin(), buses.end());
-        return buses;
+        const size_t begin = stop_bus_offsets_[*stop];
+        return std::span(stop_bus_ids_.data() + begin, stop_bus_offsets_[*stop + 1] - begin);
     }
 
     std::optional<domain::BusInfo> TransportCatalogue::GetBusInfo(std::string_view bus_name) const noexcept {
-        const domain::Bus *bus = FindBus(bus_name);
+        const auto bus = FindBus(bus_name);
         if (!bus) {
             return std::nullopt;
         }
+        return bus_infos_[*bus];
+    }
 
-        domain::BusInfo info;
-        info.name = bus->name;
-        info.stop_count = bus->stops.size();
-
-        std::unordered_set<const domain::Stop *> unique(bus->stops.begin(), bus->stops.end());
-        info.unique_stop_count = unique.size();
+    uint64_t TransportCatalogue::ComputeContentHash() const {
+        ContentHasher hasher;
 
-        double geo_length = 0;
-        int road_length = 0;
+        std::vector<domain::StopId> stops(stop_names_.size());
+        for (size_t i = 0; i < stops.size(); ++i) {
+            stops[i] = static_cast<domain::StopId>(i);
+        }
+        std::sort(stops.begin(), stops.end(), [this](domain::StopId lhs, domain::StopId rhs) {
+            return stop_names_[lhs] < stop_names_[rhs];
+        });
+        hasher.Add(static_cast<uint64_t>(stops.size()));
+        for (const domain::StopId stop: stops) {
+            hasher.Add(stop_names_[stop]);
+            hasher.Add(GetStopCoordinates(stop).lat);
+            hasher.Add(GetStopCoordinates(stop).lng);
+        }
 
-        for (size_t i = 0; i + 1 < bus->stops.size(); ++i) {
-            geo_length += geo::ComputeDistance(bus->stops[i]->coordinates,
-                                               bus->stops[i + 1]->coordinates);
-            road_length += GetDistance(bus->stops[i], bus->stops[i + 1]);
+        const std::vector<domain::BusId> buses = GetAllBuses();
+        hasher.Add(static_cast<uint64_t>(buses.size()));
+        for (const domain::BusId bus: buses) {
+            hasher.Add(bus_names_[bus]);
+            hasher.Add(static_cast<bool>(bus_is_roundtrip_[bus]));
+            hasher.Add(static_cast<uint64_t>(bus_stops_[bus].size()));
+            for (const domain::StopId stop: bus_stops_[bus]) {
+                hasher.Add(stop_names_[stop]);
+            }
         }
 
-        info.route_length = road_length;
-        info.curvature = geo_length > 0 ? road_length / geo_length : 0.0;
+        std::vector<std::tuple<std::string_view, std::string_view, int> > distances;
+        distances.reserve(distances_.GetExplicitCount());
+        distances_.ForEachExplicit([&](domain::StopId from, domain::StopId to, int distance) {
+            distances.emplace_back(stop_names_[from], stop_names_[to], distance);
+        });
+        std::sort(distances.begin(), distances.end());
+        hasher.Add(static_cast<uint64_t>(distances.size()));
+        for (const auto &[from, to, distance]: distances) {
+            hasher.Add(from);
+            hasher.Add(to);
+            hasher.Add(distance);
+        }
 
-        return info;
+        return hasher.GetHash();
     }
 }
@@ -1,55 +1,142 @@
 #pragma once
 
-#include <deque>
+#include <cstdint>
 #include <optional>
-
+#include <span>
 #include <string>
 #include <string_view>
 #include <unordered_map>
-#include <unordered_set>
 #include <vector>
 
 #include "geo.h"
 #include "domain.h"
+#include "distance_table.h"
+#include "string_arena.h"
 
 namespace transport_catalogue {
+    // Stops and buses are addressed by dense ids and stored column by column. Names are
+    // resolved to ids only at the API boundary (FindStop, FindBus and the name-based queries).
+    // The stop-to-buses index is built by Freeze once all stops and buses are added; adding
+    // a stop or adding or removing a bus unfreezes the catalogue until the next Freeze.
     class TransportCatalogue {
     public:
+        // Copies a name into the catalogue ahead of AddStop or AddBus, which then keep the
+        // returned view instead of copying the name again.
+        std::string_view StoreName(std::string_view name) {
+            return names_.Store(name);
+        }
+
         void AddStop(std::string_view name, const geo::Coordinates &coordinates);
 
         void AddBus(std::string_view bus_name, const std::vector<std::string_view> &stops_names, bool is_roundtrip);
 
-        std::vector<std::string_view> GetAllBusNames() const;
+        // The id of a removed bus is not reused; adding the bus again assigns a new one.
+        void RemoveBus(std::string_view bus_name);
 
-        std::vector<const domain::Stop *> GetAllStops() const;
+        void Freeze();
 
-        void SetDistance(const std::string &from, const std::string &to, int distance);
+        bool IsFrozen() const {
+            return frozen_;
+        }
 
-        int GetDistance(const domain::Stop *from, const domain::Stop *to) const;
+        std::optional<domain::StopId> FindStop(std::string_view name) const noexcept;
 
-        const domain::Stop *FindStop(std::string_view name) const noexcept;
+        std::optional<domain::BusId> FindBus(std::string_view name) const noexcept;
 
-        const domain::Bus *FindBus(std::string_view name) const noexcept;
+        size_t GetStopCount() const {
+            return stop_names_.size();
+        }
 
-        std::optional<std::vector<std::string_view> > GetBusesByStop(std::string_view stop_name) const;
+        std::string_view GetStopName(domain::StopId stop) const {
+            return stop_names_[stop];
+        }
 
-        std::optional<domain::BusInfo> GetBusInfo(std::string_view bus_name) const noexcept;
+        const geo::Coordinates &GetStopCoordinates(domain::StopId stop) const {
+            return stop_trig_coordinates_[stop].coordinates;
+        }
 
-    private:
-        std::deque<std::string> stops_storage_;
-        std::deque<std::string> buses_storage_;
+        std::string_view GetBusName(domain::BusId bus) const {
+            return bus_names_[bus];
+        }
+
+        // The stops in the order the bus passes them; a non-roundtrip bus also lists the way back.
+        std::span<const domain::StopId> GetBusStops(domain::BusId bus) const {
+            return bus_stops_[bus];
+        }
+
+        bool IsRoundtrip(domain::BusId bus) const {
+            return bus_is_roundtrip_[bus];
+        }
+
+        // Road distance from the first stop of GetBusStops(bus) to each of its stops, meters.
+        std::span<const double> GetBusRoadDistances(domain::BusId bus) const {
+            return bus_road_distances_[bus];
+        }
+
+        // The buses that are not removed, sorted by name.
+        std::vector<domain::BusId> GetAllBuses() const;
 
-        std::unordered_map<std::string_view, domain::Stop> all_stops_;
-        std::unordered_map<std::string_view, domain::Bus> all_routes_;
+        std::vector<std::string_view> GetAllBusNames() const;
+
+        void SetDistance(std::string_view from, std::string_view to, int distance);
+
+        int GetDistance(domain::StopId from, domain::StopId to) const;
 
-        std::unordered_map<const domain::Stop *, std::unordered_set<std::string_view> > stops_to_buses_;
+        // The buses that pass the stop, sorted by name. Requires a frozen catalogue.
+        std::optional<std::span<const domain::BusId> > GetBusesByStop(std::string_view stop_name) const;
+
+        // Up to date once the catalogue is frozen: stop changes made while it is not are applied
+        // to the buses already added by the next Freeze.
+        std::optional<domain::BusInfo> GetBusInfo(std::string_view bus_name) const noexcept;
 
-        struct StopPairHash {
-            size_t operator()(const std::pair<const domain::Stop *, const domain::Stop *> &p) const noexcept {
-                return std::hash<const void *>()(p.first) ^ (std::hash<const void *>()(p.second) << 1);
-            }
+        // Fingerprint of all stops, buses and distances, independent of insertion order.
+        uint64_t ComputeContentHash() const;
+
+        // Memory held by the stop and bus names, in bytes.
+        size_t GetNamesMemoryUsage() const {
+            return names_.GetAllocatedBytes();
+        }
+
+    private:
+        // A view of the name that lives as long as the catalogue.
+        std::string_view KeepName(std::string_view name) {
+            return names_.Contains(name) ? name : names_.Store(name);
+        }
+
+        // Recomputes the distance prefix sums and the BusInfo of the bus.
+        void UpdateBusStats(domain::BusId bus);
+
+        void UpdateBusStatsAtStop(domain::StopId stop);
+
+        // Owns the stop and bus names that every string_view in the catalogue refers to.
+        StringArena names_;
+
+        std::unordered_map<std::string_view, domain::StopId> stop_ids_;
+        std::unordered_map<std::string_view, domain::BusId> bus_ids_;
+
+        // Indexed by StopId.
+        std::vector<std::string_view> stop_names_;
+        std::vector<geo::TrigCoordinates> stop_trig_coordinates_;
+        // The buses of stop s are stop_bus_ids_[stop_bus_offsets_[s], stop_bus_offsets_[s + 1]).
+        std::vector<size_t> stop_bus_offsets_;
+        std::vector<domain::BusId> stop_bus_ids_;
+        bool frozen_ = false;
+
+        // Stops moved or given a distance while unfrozen, with the bus count at that moment.
+        struct PendingStopUpdate {
+            domain::StopId stop;
+            size_t bus_count;
         };
+        std::vector<PendingStopUpdate> pending_stop_updates_;
+
+        // Indexed by BusId.
+        std::vector<std::string_view> bus_names_;
+        std::vector<std::vector<domain::StopId> > bus_stops_;
+        std::vector<bool> bus_is_roundtrip_;
+        std::vector<std::vector<double> > bus_road_distances_;
+        std::vector<std::vector<double> > bus_geo_distances_;
+        std::vector<domain::BusInfo> bus_infos_;
 
-        std::unordered_map<std::pair<const domain::Stop *, const domain::Stop *>, int, StopPairHash> distances_;
+        DistanceTable distances_;
     };
 }
@@ -1,51 +1,108 @@
 #include "transport_router.h"
+#include "content_hash.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
 #include <stdexcept>
+#include <system_error>
+#include <thread>
 
 using namespace transport_router;
 using namespace transport_catalogue;
 
+namespace {
+    constexpr std::array<char, 8> ROUTING_TABLE_MAGIC = {'T', 'C', 'R', 'O', 'U', 'T', 'E', '\0'};
+    constexpr uint32_t ROUTING_TABLE_VERSION = 1;
+    constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    // File layout: header, edge records, name records (stops in wait-vertex order, then buses)
+    // padded to 8 bytes, the V x V weight matrix and the V x V packed predecessor matrix, all
+    // in native byte order. Both matrices are used in place from the mapping.
+    struct RoutingTableHeader {
+        std::array<char, 8> magic;
+        uint32_t version;
+        uint32_t byte_order_mark;
+        uint64_t weight_size;
+        uint64_t catalogue_hash;
+        uint64_t settings_hash;
+        uint64_t vertex_count;
+        uint64_t edge_count;
+        uint64_t bus_count;
+        uint64_t names_size;
+    };
+
+    struct EdgeRecord {
+        uint64_t from;
+        uint64_t to;
+        double weight;
+        uint32_t bus_id;
+        uint32_t span_count;
+    };
+
+    static_assert(sizeof(RoutingTableHeader) % 8 == 0 && sizeof(EdgeRecord) % 8 == 0);
+
+    using PackedEdgeId = graph::FlatRouter<double>::PackedEdgeId;
+}
+
 void TransportRouter::SetRoutingSettings(RoutingSettings settings) {
     routing_settings_ = settings;
 }
 
-graph::VertexId TransportRouter::GetWaitVertex(std::string_view stop_name) const {
-    auto it = stop_wait_vertex_.find(std::string(stop_name));
-    if (it == stop_wait_vertex_.end()) {
-        throw std::out_of_range("Stop not found: " + std::string(stop_name));
+void TransportRouter::BuildGraph(const TransportCatalogue& tc) {
+    router_.reset();
+    routing_table_mapping_.reset();
+
+    const RouterMode mode = routing_settings_.router_mode;
+    const bool uses_routing_table_file = !routing_settings_.routing_table_file.empty()
+                                         && (mode == RouterMode::ALL_PAIRS || mode == RouterMode::ALL_PAIRS_FLAT);
+    if (!uses_routing_table_file) {
+        FillGraph(tc);
+        if (mode != RouterMode::RAPTOR) {
+            router_ = CreateRouter();
+        }
+        return;
     }
-    return it->second;
-}
 
-graph::VertexId TransportRouter::GetBusVertex(std::string_view stop_name) const {
-    auto it = stop_bus_vertex_.find(std::string(stop_name));
-    if (it == stop_bus_vertex_.end()) {
-        throw std::out_of_range("Stop not found: " + std::string(stop_name));
+    // Only the flat table has a layout that can be served straight from the file.
+    const uint64_t catalogue_hash = tc.ComputeContentHash();
+    if (LoadRoutingTable(tc, catalogue_hash)) {
+        return;
     }
-    return it->second;
+    FillGraph(tc);
+    router_ = std::make_unique<graph::FlatRouter<double>>(graph_, routing_settings_.router_threads);
+    SaveRoutingTable(catalogue_hash);
 }
 
-void TransportRouter::BuildGraph(const TransportCatalogue& tc) {
+void TransportRouter::FillGraph(const TransportCatalogue& tc) {
     stop_wait_vertex_.clear();
-    stop_bus_vertex_.clear();
     vertex_to_stop_name_.clear();
+    vertex_coordinates_.clear();
     graph_ = graph::DirectedWeightedGraph<double>();
 
-    const auto stops = tc.GetAllStops();
-    graph_.Resize(stops.size() * 2);
+    const size_t stop_count = tc.GetStopCount();
+    graph_.Resize(stop_count * 2);
 
-    vertex_to_stop_name_.resize(stops.size() * 2);
-    for (size_t i = 0; i < stops.size(); ++i) {
-        const auto* stop = stops[i];
-        std::string name = std::string(stop->name);
+    vertex_to_stop_name_.resize(stop_count * 2);
+    vertex_coordinates_.resize(stop_count * 2);
+    // Vertices follow stop insertion order. The all-pairs tables add edge weights in vertex
+    // order, so reordering the stops can move a total_time by a rounding step.
+    for (domain::StopId stop = 0; stop < stop_count; ++stop) {
+        const std::string_view name = tc.GetStopName(stop);
 
-        graph::VertexId wait_v = 2 * i;
-        graph::VertexId bus_v = 2 * i + 1;
+        graph::VertexId wait_v = GetWaitVertex(stop);
+        graph::VertexId bus_v = GetBusVertex(stop);
 
         stop_wait_vertex_[name] = wait_v;
-        stop_bus_vertex_[name] = bus_v;
 
         vertex_to_stop_name_[wait_v] = name;
         vertex_to_stop_name_[bus_v] = name;
+        vertex_coordinates_[wait_v] = tc.GetStopCoordinates(stop);
+        vertex_coordinates_[bus_v] = tc.GetStopCoordinates(stop);
 
         graph::Edge<double> wait_edge;
         wait_edge.from = wait_v;
@@ -54,78 +111,559 @@ void TransportRouter::BuildGraph(const TransportCatalogue& tc) {
         graph_.AddEdge(wait_edge);
     }
 
-    const auto buses = tc.GetAllBusNames();
-    for (const auto& name : buses) {
-        const auto* bus = tc.FindBus(name);
-        if (!bus) continue;
+    bus_names_.clear();
+    bus_ids_.clear();
+    bus_edges_.clear();
+    road_to_geo_ratio_.reset();
+    raptor_router_.reset();
+    if (routing_settings_.router_mode == RouterMode::RAPTOR) {
+        raptor_router_ = std::make_unique<RaptorRouter>(stop_count, routing_settings_.bus_wait_time,
+                                                        routing_settings_.bus_velocity);
+    }
+    for (const domain::BusId bus : tc.GetAllBuses()) {
+        AddBusEdges(tc, bus);
+    }
+    graph_.Freeze(UsesIncomingEdges());
+}
+
+std::vector<graph::EdgeId> TransportRouter::AddBusEdges(const TransportCatalogue& tc, domain::BusId bus) {
+    const auto ridden = GetRiddenStops(tc, bus);
+    const auto& seq = ridden.stops;
+    // Only the A* estimate reads the ratio.
+    if (routing_settings_.router_mode == RouterMode::A_STAR) {
+        for (size_t i = 0; i + 1 < seq.size(); ++i) {
+            UpdateRoadToGeoRatio(tc, seq[i], seq[i + 1]);
+        }
+    }
+
+    const graph::BusId bus_id = GetOrAddBusId(tc.GetBusName(bus));
+    if (raptor_router_) {
+        // The line replaces the bus's stop-pair edges altogether; its id is bus_id, as both
+        // are assigned in build order.
+        raptor_router_->AddLine(MakeLine(ridden));
+        return {};
+    }
+    auto& edge_ids = bus_edges_[bus_id];
+    edge_ids.clear();
+    for (const auto& edge : MakeBusEdges(bus_id, ridden)) {
+        edge_ids.push_back(graph_.AddEdge(edge));
+    }
+    return edge_ids;
+}
+
+void TransportRouter::UpdateRoadToGeoRatio(const TransportCatalogue& tc, domain::StopId from, domain::StopId to) {
+    const double geo_dist = geo::ComputeDistance(tc.GetStopCoordinates(from), tc.GetStopCoordinates(to));
+    if (geo_dist > 0) {
+        const double ratio = tc.GetDistance(from, to) / geo_dist;
+        road_to_geo_ratio_ = std::min(road_to_geo_ratio_.value_or(ratio), ratio);
+    }
+}
+
+graph::BusId TransportRouter::GetOrAddBusId(std::string_view bus_name) {
+    auto [it, inserted] = bus_ids_.emplace(bus_name, static_cast<graph::BusId>(bus_names_.size()));
+    if (inserted) {
+        bus_names_.push_back(bus_name);
+        bus_edges_.emplace_back();
+    } else {
+        // A bus that was removed and added again has a new name string in the catalogue.
+        bus_names_[it->second] = bus_name;
+    }
+    return it->second;
+}
+
+TransportRouter::RiddenStops TransportRouter::GetRiddenStops(const TransportCatalogue& tc, domain::BusId bus) {
+    const auto stops = tc.GetBusStops(bus);
+    const auto distances = tc.GetBusRoadDistances(bus);
+    RiddenStops ridden{{stops.begin(), stops.end()}, {distances.begin(), distances.end()}};
+    if (!tc.IsRoundtrip(bus)) {
+        // The stop list of a non-roundtrip bus already goes there and back and reads the same
+        // both ways, so riding it back once more repeats it from its second stop.
+        for (size_t i = 1; i < stops.size(); ++i) {
+            ridden.stops.push_back(stops[i]);
+            ridden.distances.push_back(distances.back() + distances[i]);
+        }
+    }
+    return ridden;
+}
+
+std::vector<graph::Edge<double>> TransportRouter::MakeBusEdges(graph::BusId bus_id, const RiddenStops& ridden) const {
+    const auto& seq = ridden.stops;
+    std::vector<graph::Edge<double>> edges;
+    edges.reserve(seq.size() * seq.size() / 2);
+    for (size_t i = 0; i < seq.size(); ++i) {
+        for (size_t j = i + 1; j < seq.size(); ++j) {
+            const double dist = ridden.distances[j] - ridden.distances[i];
+            double t = (dist / 1000.0) / routing_settings_.bus_velocity * 60.0;
 
-        std::vector<const domain::Stop*> seq = bus->stops;
-        if (!bus->is_roundtrip) {
-            for (int i = seq.size() - 2; i >= 0; --i) {
-                seq.push_back(seq[i]);
+            graph::Edge<double> e;
+            e.from = GetBusVertex(seq[i]);
+            e.to = GetWaitVertex(seq[j]);
+            e.weight = t;
+            e.bus_id = bus_id;
+            e.span_count = j - i;
+            edges.push_back(std::move(e));
+        }
+    }
+    return edges;
+}
+
+RaptorRouter::Line TransportRouter::MakeLine(const RiddenStops& ridden) {
+    return {{ridden.stops.begin(), ridden.stops.end()}, ridden.distances};
+}
+
+void TransportRouter::AddBus(const TransportCatalogue& tc, std::string_view bus_name) {
+    const auto bus = tc.FindBus(bus_name);
+    if (!bus) {
+        throw std::invalid_argument("Unknown bus name in AddBus: " + std::string(bus_name));
+    }
+    const auto stops = tc.GetBusStops(*bus);
+    const bool knows_all_stops = std::all_of(stops.begin(), stops.end(), [this](domain::StopId stop) {
+        return GetWaitVertex(stop) < graph_.GetVertexCount();
+    });
+    if (!router_ || !knows_all_stops) {
+        // New stops change the vertex set, which every routing table is sized by. RAPTOR keeps
+        // nothing but the lines, so it is simply built again.
+        BuildGraph(tc);
+        return;
+    }
+
+    std::vector<graph::EdgeId> removed_edges;
+    if (auto it = bus_ids_.find(bus_name); it != bus_ids_.end()) {
+        removed_edges = std::move(bus_edges_[it->second]);
+        for (const auto edge_id : removed_edges) {
+            graph_.RemoveEdge(edge_id);
+        }
+    }
+    ApplyGraphChanges(removed_edges, AddBusEdges(tc, *bus));
+}
+
+void TransportRouter::RemoveBus(const TransportCatalogue& tc, std::string_view bus_name) {
+    auto it = bus_ids_.find(bus_name);
+    if (it == bus_ids_.end()) {
+        throw std::invalid_argument("Unknown bus name in RemoveBus: " + std::string(bus_name));
+    }
+    if (!router_) {
+        BuildGraph(tc);
+        return;
+    }
+    const graph::BusId bus_id = it->second;
+    bus_ids_.erase(it);
+    const std::vector<graph::EdgeId> removed_edges = std::move(bus_edges_[bus_id]);
+    bus_edges_[bus_id].clear();
+    for (const auto edge_id : removed_edges) {
+        graph_.RemoveEdge(edge_id);
+    }
+    ApplyGraphChanges(removed_edges, {});
+}
+
+void TransportRouter::UpdateDistance(const TransportCatalogue& tc, std::string_view from, std::string_view to) {
+    const auto stop_from = tc.FindStop(from);
+    const auto stop_to = tc.FindStop(to);
+    if (!stop_from || !stop_to) {
+        throw std::invalid_argument("Unknown stop name in UpdateDistance");
+    }
+    if (!router_) {
+        BuildGraph(tc);
+        return;
+    }
+
+    // A distance set for one direction is also used for the other one when that is not set.
+    std::vector<graph::EdgeId> changed_edges;
+    const auto buses = tc.GetBusesByStop(from);
+    for (const domain::BusId bus : *buses) {
+        auto it = bus_ids_.find(tc.GetBusName(bus));
+        if (it == bus_ids_.end()) continue;
+
+        const auto ridden = GetRiddenStops(tc, bus);
+        const auto& seq = ridden.stops;
+        bool rides_segment = false;
+        for (size_t i = 0; i + 1 < seq.size(); ++i) {
+            if ((seq[i] == *stop_from && seq[i + 1] == *stop_to) || (seq[i] == *stop_to && seq[i + 1] == *stop_from)) {
+                rides_segment = true;
+                if (routing_settings_.router_mode == RouterMode::A_STAR) {
+                    UpdateRoadToGeoRatio(tc, seq[i], seq[i + 1]);
+                }
             }
         }
+        if (!rides_segment) continue;
 
-        for (size_t i = 0; i < seq.size(); ++i) {
-            double dist = 0;
-            for (size_t j = i + 1; j < seq.size(); ++j) {
-                dist += tc.GetDistance(seq[j - 1], seq[j]);
-                double t = (dist / 1000.0) / routing_settings_.bus_velocity * 60.0;
+        const auto& edge_ids = bus_edges_[it->second];
+        const auto edges = MakeBusEdges(it->second, ridden);
+        for (size_t i = 0; i < edges.size(); ++i) {
+            const graph::EdgeId edge_id = edge_ids[i];
+            if (graph_.GetEdge(edge_id).weight != edges[i].weight) {
+                graph_.SetEdgeWeight(edge_id, edges[i].weight);
+                changed_edges.push_back(edge_id);
+            }
+        }
+    }
+    ApplyGraphChanges(changed_edges, changed_edges);
+}
+
+void TransportRouter::ApplyGraphChanges(const std::vector<graph::EdgeId>& invalidated_edges,
+                                        const std::vector<graph::EdgeId>& relaxing_edges) {
+    graph_.Freeze(UsesIncomingEdges());
+    if (invalidated_edges.empty() && relaxing_edges.empty()) return;
+
+    if (auto* router = std::get_if<std::unique_ptr<graph::Router<double>>>(&*router_)) {
+        (*router)->Update(invalidated_edges, relaxing_edges);
+    } else if (auto* flat_router = std::get_if<std::unique_ptr<graph::FlatRouter<double>>>(&*router_)) {
+        (*flat_router)->Update(invalidated_edges, relaxing_edges);
+    } else if (auto* dijkstra_router = std::get_if<std::unique_ptr<graph::DijkstraRouter<double>>>(&*router_)) {
+        (*dijkstra_router)->ClearCache();
+    } else if (std::holds_alternative<std::unique_ptr<graph::ContractionHierarchyRouter<double>>>(*router_)) {
+        // The contraction order depends on all weights, so the hierarchy is rebuilt.
+        router_ = CreateRouter();
+    }
+    // A* and bidirectional Dijkstra keep no state derived from the graph.
+}
+
+bool TransportRouter::MatchesRebuild(const TransportCatalogue& tc) const {
+    RoutingSettings settings = routing_settings_;
+    settings.routing_table_file.clear();
+    TransportRouter rebuilt;
+    rebuilt.SetRoutingSettings(std::move(settings));
+    rebuilt.BuildGraph(tc);
 
-                graph::Edge<double> e;
-                e.from = GetBusVertex(seq[i]->name);
-                e.to = GetWaitVertex(seq[j]->name);
-                e.weight = t;
-                e.bus_name = name;
-                e.span_count = j - i;
-                graph_.AddEdge(e);
+    // Equal routes may differ by rounding: a repaired table adds the weights in another order.
+    constexpr double RELATIVE_TOLERANCE = 1e-9;
+    for (domain::StopId from = 0; from < tc.GetStopCount(); ++from) {
+        for (domain::StopId to = 0; to < tc.GetStopCount(); ++to) {
+            const auto route = BuildRoute(tc.GetStopName(from), tc.GetStopName(to));
+            const auto expected = rebuilt.BuildRoute(tc.GetStopName(from), tc.GetStopName(to));
+            if (route.has_value() != expected.has_value()) {
+                return false;
+            }
+            if (route && std::abs(route->total_time - expected->total_time)
+                             > RELATIVE_TOLERANCE * std::max(1.0, expected->total_time)) {
+                return false;
             }
         }
     }
+    return true;
+}
 
-    router_ = std::make_unique<graph::Router<double>>(graph_);
+uint64_t TransportRouter::ComputeSettingsHash() const {
+    ContentHasher hasher;
+    hasher.Add(routing_settings_.bus_wait_time);
+    hasher.Add(routing_settings_.bus_velocity);
+    return hasher.GetHash();
+}
+
+bool TransportRouter::LoadRoutingTable(const TransportCatalogue& tc, uint64_t catalogue_hash) {
+    auto mapping = MappedFile::Open(routing_settings_.routing_table_file);
+    if (!mapping) {
+        return false;
+    }
+    const std::span<const std::byte> data = mapping->GetData();
+    if (data.size() < sizeof(RoutingTableHeader)) {
+        return false;
+    }
+    RoutingTableHeader header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != ROUTING_TABLE_MAGIC || header.version != ROUTING_TABLE_VERSION
+        || header.byte_order_mark != BYTE_ORDER_MARK || header.weight_size != sizeof(double)
+        || header.catalogue_hash != catalogue_hash || header.settings_hash != ComputeSettingsHash()) {
+        return false;
+    }
+
+    const size_t cell_size = sizeof(double) + sizeof(PackedEdgeId);
+    if (header.vertex_count % 2 != 0 || header.vertex_count > std::numeric_limits<uint32_t>::max()
+        || header.vertex_count * header.vertex_count > data.size() / cell_size
+        || header.edge_count > data.size() / sizeof(EdgeRecord)
+        || header.names_size > data.size() || header.names_size % 8 != 0) {
+        return false;
+    }
+    const size_t vertex_count = header.vertex_count;
+    const size_t cell_count = vertex_count * vertex_count;
+    const size_t edges_offset = sizeof(RoutingTableHeader);
+    const size_t names_offset = edges_offset + header.edge_count * sizeof(EdgeRecord);
+    const size_t weights_offset = names_offset + header.names_size;
+    const size_t prev_edges_offset = weights_offset + cell_count * sizeof(double);
+    if (prev_edges_offset + cell_count * sizeof(PackedEdgeId) != data.size()) {
+        return false;
+    }
+
+    std::vector<std::string_view> names;
+    const char* const names_begin = reinterpret_cast<const char*>(data.data() + names_offset);
+    for (size_t position = 0; names.size() < vertex_count / 2 + header.bus_count;) {
+        uint32_t size = 0;
+        if (position + sizeof(size) > header.names_size) {
+            return false;
+        }
+        std::memcpy(&size, names_begin + position, sizeof(size));
+        position += sizeof(size);
+        if (size > header.names_size - position) {
+            return false;
+        }
+        names.emplace_back(names_begin + position, size);
+        position += size;
+    }
+
+    // Names are resolved to the catalogue's own strings, which outlive the mapping. The
+    // vertices of a stop are derived from its id, so the stops must also keep their ids.
+    std::vector<std::string_view> stop_names;
+    for (size_t i = 0; i < vertex_count / 2; ++i) {
+        const auto stop = tc.FindStop(names[i]);
+        if (!stop || *stop != i) {
+            return false;
+        }
+        stop_names.push_back(tc.GetStopName(*stop));
+    }
+    std::vector<std::string_view> bus_names;
+    for (size_t i = 0; i < header.bus_count; ++i) {
+        const auto bus = tc.FindBus(names[vertex_count / 2 + i]);
+        if (!bus) {
+            return false;
+        }
+        bus_names.push_back(tc.GetBusName(*bus));
+    }
+
+    std::vector<graph::Edge<double>> edges(header.edge_count);
+    for (size_t i = 0; i < edges.size(); ++i) {
+        EdgeRecord record;
+        std::memcpy(&record, data.data() + edges_offset + i * sizeof(EdgeRecord), sizeof(record));
+        if (record.from >= vertex_count || record.to >= vertex_count
+            || (record.bus_id != graph::NO_BUS && record.bus_id >= header.bus_count)) {
+            return false;
+        }
+        edges[i].from = record.from;
+        edges[i].to = record.to;
+        edges[i].weight = record.weight;
+        edges[i].bus_id = record.bus_id;
+        edges[i].span_count = record.span_count;
+    }
+
+    stop_wait_vertex_.clear();
+    vertex_coordinates_.clear();
+    vertex_to_stop_name_.assign(vertex_count, {});
+    for (size_t i = 0; i < vertex_count / 2; ++i) {
+        const std::string_view name = stop_names[i];
+        stop_wait_vertex_[name] = GetWaitVertex(i);
+        vertex_to_stop_name_[GetWaitVertex(i)] = name;
+        vertex_to_stop_name_[GetBusVertex(i)] = name;
+    }
+
+    bus_names_.clear();
+    bus_ids_.clear();
+    bus_edges_.clear();
+    for (size_t i = 0; i < header.bus_count; ++i) {
+        GetOrAddBusId(bus_names[i]);
+    }
+    road_to_geo_ratio_.reset();
+    graph_ = graph::DirectedWeightedGraph<double>();
+    graph_.Resize(vertex_count);
+    for (const auto& edge : edges) {
+        const graph::EdgeId edge_id = graph_.AddEdge(edge);
+        if (edge.bus_id != graph::NO_BUS) {
+            bus_edges_[edge.bus_id].push_back(edge_id);
+        }
+    }
+    graph_.Freeze();
+
+    router_ = std::make_unique<graph::FlatRouter<double>>(
+        graph_,
+        std::span(reinterpret_cast<const double*>(data.data() + weights_offset), cell_count),
+        std::span(reinterpret_cast<const PackedEdgeId*>(data.data() + prev_edges_offset), cell_count));
+    routing_table_mapping_ = std::move(mapping);
+    return true;
+}
+
+void TransportRouter::SaveRoutingTable(uint64_t catalogue_hash) const {
+    const auto& router = *std::get<std::unique_ptr<graph::FlatRouter<double>>>(*router_);
+
+    std::vector<EdgeRecord> edges(graph_.GetEdgeCount());
+    for (graph::EdgeId id = 0; id < edges.size(); ++id) {
+        const auto& edge = graph_.GetEdge(id);
+        edges[id] = EdgeRecord{edge.from, edge.to, edge.weight, edge.bus_id, static_cast<uint32_t>(edge.span_count)};
+    }
+
+    std::string names;
+    const auto append_name = [&names](std::string_view name) {
+        const auto size = static_cast<uint32_t>(name.size());
+        names.append(reinterpret_cast<const char*>(&size), sizeof(size));
+        names.append(name);
+    };
+    for (graph::VertexId vertex = 0; vertex < vertex_to_stop_name_.size(); vertex += 2) {
+        append_name(vertex_to_stop_name_[vertex]);
+    }
+    for (const auto name : bus_names_) {
+        append_name(name);
+    }
+    names.resize((names.size() + 7) / 8 * 8, '\0');
+
+    RoutingTableHeader header{};
+    header.magic = ROUTING_TABLE_MAGIC;
+    header.version = ROUTING_TABLE_VERSION;
+    header.byte_order_mark = BYTE_ORDER_MARK;
+    header.weight_size = sizeof(double);
+    header.catalogue_hash = catalogue_hash;
+    header.settings_hash = ComputeSettingsHash();
+    header.vertex_count = graph_.GetVertexCount();
+    header.edge_count = edges.size();
+    header.bus_count = bus_names_.size();
+    header.names_size = names.size();
+
+    // Written next to the target and renamed, so a concurrent reader never maps a partial file.
+    // The file is only a cache: if it cannot be written, the temporary file is removed and the
+    // run goes on with the table in memory.
+    const std::string& path = routing_settings_.routing_table_file;
+    const std::string temporary_path = path + ".tmp";
+    std::error_code error;
+    {
+        std::ofstream out(temporary_path, std::ios::binary | std::ios::trunc);
+        const auto write = [&out](const void* bytes, size_t size) {
+            out.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(size));
+        };
+        write(&header, sizeof(header));
+        write(edges.data(), edges.size() * sizeof(EdgeRecord));
+        write(names.data(), names.size());
+        write(router.GetWeights().data(), router.GetWeights().size_bytes());
+        write(router.GetPrevEdges().data(), router.GetPrevEdges().size_bytes());
+        out.close();
+        if (!out) {
+            std::filesystem::remove(temporary_path, error);
+            return;
+        }
+    }
+    std::filesystem::rename(temporary_path, path, error);
+    if (error) {
+        std::filesystem::remove(temporary_path, error);
+    }
+}
+
+double TransportRouter::EstimateRemainingTime(graph::VertexId vertex, graph::VertexId target) const {
+    const double geo_dist = geo::ComputeDistance(vertex_coordinates_[vertex], vertex_coordinates_[target]);
+    // Road distances may be shorter than geodesic ones, so the estimate is scaled by the
+    // smallest road/geodesic ratio over all ridden segments; a small margin absorbs rounding.
+    const double road_to_geo_ratio = road_to_geo_ratio_.value_or(1.0) * (1.0 - 1e-9);
+    double time = (road_to_geo_ratio * geo_dist / 1000.0) / routing_settings_.bus_velocity * 60.0;
+    // Leaving any other stop's wait vertex (GetWaitVertex gives even ids, see FillGraph) costs at least one wait.
+    if (vertex != target && vertex % 2 == 0) {
+        time += routing_settings_.bus_wait_time;
+    }
+    return time;
+}
+
+TransportRouter::RouterEngine TransportRouter::CreateRouter() const {
+    switch (routing_settings_.router_mode) {
+        case RouterMode::ALL_PAIRS_FLAT:
+            return std::make_unique<graph::FlatRouter<double>>(graph_, routing_settings_.router_threads);
+        case RouterMode::DIJKSTRA:
+            return std::make_unique<graph::DijkstraRouter<double>>(graph_, routing_settings_.route_cache_size);
+        case RouterMode::CONTRACTION_HIERARCHIES:
+            return std::make_unique<graph::ContractionHierarchyRouter<double>>(graph_);
+        case RouterMode::A_STAR:
+            return std::make_unique<graph::AStarRouter<double>>(graph_, [this](graph::VertexId vertex,
+                                                                               graph::VertexId target) {
+                return EstimateRemainingTime(vertex, target);
+            });
+        case RouterMode::BIDIRECTIONAL_DIJKSTRA:
+            return std::make_unique<graph::BidirectionalDijkstraRouter<double>>(graph_);
+        case RouterMode::RAPTOR:
+            throw std::logic_error("RAPTOR mode searches bus lines, not the graph");
+        case RouterMode::ALL_PAIRS:
+            break;
+    }
+    return std::make_unique<graph::Router<double>>(graph_);
 }
 
 std::optional<Route> TransportRouter::BuildRoute(std::string_view from, std::string_view to) const {
-    if (!router_) return std::nullopt;
+    if (!router_ && !raptor_router_) return std::nullopt;
 
-    auto it_from = stop_wait_vertex_.find(std::string(from));
-    auto it_to = stop_wait_vertex_.find(std::string(to));
+    auto it_from = stop_wait_vertex_.find(from);
+    auto it_to = stop_wait_vertex_.find(to);
     if (it_from == stop_wait_vertex_.end() || it_to == stop_wait_vertex_.end()) {
         return std::nullopt;
     }
 
-    auto info = router_->BuildRoute(it_from->second, it_to->second);
-    if (!info) return std::nullopt;
-
     Route route;
-    route.total_time = info->weight;
-
-    for (auto id : info->edges) {
-        const auto& e = graph_.GetEdge(id);
-        if (e.bus_name.empty()) {
-            route.items.emplace_back(WaitItem{vertex_to_stop_name_[e.from], e.weight});
-        } else {
-            route.items.emplace_back(BusItem{e.bus_name, e.span_count, e.weight});
-        }
-    }
-
-    std::vector<RouteItem> merged;
-    for (const auto& item : route.items) {
-        if (!merged.empty()) {
-            if (auto* last_bus = std::get_if<BusItem>(&merged.back())) {
-                if (auto* cur_bus = std::get_if<BusItem>(&item)) {
-                    if (last_bus->bus == cur_bus->bus) {
-                        last_bus->span_count += cur_bus->span_count;
-                        last_bus->time += cur_bus->time;
-                        continue;
-                    }
-                }
+    // Consecutive rides on the same bus are merged into one item as they are appended.
+    const auto add_ride = [&route](std::string_view bus, int span_count, double time) {
+        if (!route.items.empty()) {
+            if (auto* last_bus = std::get_if<BusItem>(&route.items.back()); last_bus && last_bus->bus == bus) {
+                last_bus->span_count += span_count;
+                last_bus->time += time;
+                return;
             }
         }
-        merged.push_back(item);
-    }
+        route.items.emplace_back(BusItem{bus, span_count, time});
+    };
+    if (raptor_router_) {
+        // RAPTOR stop indices are the wait vertices halved, see FillGraph.
+        auto journey = raptor_router_->BuildRoute(it_from->second / 2, it_to->second / 2);
+        if (!journey) return std::nullopt;
+
+        route.total_time = journey->total_time;
+        route.items.reserve(journey->rides.size() * 2);
+        for (const auto& ride : journey->rides) {
+            route.items.emplace_back(WaitItem{vertex_to_stop_name_[2 * ride.board_stop],
+                                              static_cast<double>(routing_settings_.bus_wait_time)});
+            add_ride(bus_names_[ride.line], ride.span_count, ride.time);
+        }
+    } else {
+        auto info = std::visit([&](const auto& router) {
+            return router->BuildRoute(it_from->second, it_to->second);
+        }, *router_);
+        if (!info) return std::nullopt;
 
-    route.items = std::move(merged);
+        route.total_time = info->weight;
+        route.items.reserve(info->edges.size());
+        for (auto id : info->edges) {
+            const auto& e = graph_.GetEdge(id);
+            if (e.bus_id == graph::NO_BUS) {
+                route.items.emplace_back(WaitItem{vertex_to_stop_name_[e.from], e.weight});
+            } else {
+                add_ride(bus_names_[e.bus_id], e.span_count, e.weight);
+            }
+        }
+    }
     return route;
 }
+
+std::optional<TravelTimeMatrix> TransportRouter::BuildTravelTimeMatrix(
+        const std::vector<std::string_view>& origins,
+        const std::vector<std::string_view>& destinations) const {
+    // Fails if any of the names is not a stop.
+    auto resolve = [this](const std::vector<std::string_view>& names, std::vector<graph::VertexId>& vertices) {
+        vertices.reserve(names.size());
+        for (const auto name : names) {
+            auto it = stop_wait_vertex_.find(name);
+            if (it == stop_wait_vertex_.end()) {
+                return false;
+            }
+            vertices.push_back(it->second);
+        }
+        return true;
+    };
+    std::vector<graph::VertexId> origin_vertices;
+    std::vector<graph::VertexId> destination_vertices;
+    if (!resolve(origins, origin_vertices) || !resolve(destinations, destination_vertices)) {
+        return std::nullopt;
+    }
+
+    std::vector<size_t> destination_stops;
+    for (const auto vertex : destination_vertices) {
+        destination_stops.push_back(vertex / 2);
+    }
+
+    TravelTimeMatrix times(origin_vertices.size());
+    std::atomic_size_t next_origin = 0;
+    auto worker = [&] {
+        for (size_t i = next_origin++; i < origin_vertices.size(); i = next_origin++) {
+            times[i] = raptor_router_ ? raptor_router_->BuildTimesFrom(origin_vertices[i] / 2, destination_stops)
+                                      : graph::BuildWeightsToTargets(graph_, origin_vertices[i], destination_vertices);
+        }
+    };
+
+    const size_t thread_count = std::min(routing_settings_.router_threads, origin_vertices.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < thread_count; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return times;
+}
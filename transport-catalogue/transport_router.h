@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
@@ -8,24 +9,49 @@
 #include <variant>
 #include <vector>
 
+#include "astar_router.h"
+#include "contraction_hierarchy.h"
+#include "dijkstra_router.h"
 #include "graph.h"
+#include "mapped_file.h"
+#include "raptor_router.h"
 #include "router.h"
 #include "transport_catalogue.h"
 
 namespace transport_router {
 
+    enum class RouterMode {
+        ALL_PAIRS,
+        ALL_PAIRS_FLAT,
+        DIJKSTRA,
+        CONTRACTION_HIERARCHIES,
+        A_STAR,
+        BIDIRECTIONAL_DIJKSTRA,
+        RAPTOR,
+    };
+
     struct RoutingSettings {
         int bus_wait_time = 0;
         double bus_velocity = 0.0;
+        RouterMode router_mode = RouterMode::ALL_PAIRS;
+        size_t route_cache_size = graph::DijkstraRouter<double>::DEFAULT_CACHE_CAPACITY;
+        size_t router_threads = 1;
+        // When set, the all-pairs modes persist the graph and the routing table to this file
+        // and load it on the next start if the catalogue and settings are unchanged. Saving is
+        // best-effort. ALL_PAIRS then runs as ALL_PAIRS_FLAT, the only table layout that can be
+        // served from the file; both give the same routes.
+        std::string routing_table_file;
     };
 
+    // Route items refer to the catalogue's stop and bus names, so a route must not outlive
+    // the catalogue it was built from.
     struct WaitItem {
-        std::string stop_name;
+        std::string_view stop_name;
         double time = 0.0;
     };
 
     struct BusItem {
-        std::string bus;
+        std::string_view bus;
         int span_count = 0;
         double time = 0.0;
     };
@@ -37,6 +63,10 @@ namespace transport_router {
         std::vector<RouteItem> items;
     };
 
+    // times[i][j] is the total_time from origins[i] to destinations[j], or std::nullopt
+    // when there is no route.
+    using TravelTimeMatrix = std::vector<std::vector<std::optional<double>>>;
+
     class TransportRouter {
     public:
         TransportRouter() = default;
@@ -45,21 +75,95 @@ namespace transport_router {
 
         void BuildGraph(const transport_catalogue::TransportCatalogue& tc);
 
+        // Incremental updates for a catalogue that already holds the change and is frozen again.
+        // Only the edges of the affected buses are touched and the routing data is repaired
+        // instead of rebuilt. AddBus also replaces a bus that is already there.
+        void AddBus(const transport_catalogue::TransportCatalogue& tc, std::string_view bus_name);
+
+        void RemoveBus(const transport_catalogue::TransportCatalogue& tc, std::string_view bus_name);
+
+        void UpdateDistance(const transport_catalogue::TransportCatalogue& tc, std::string_view from,
+                            std::string_view to);
+
+        // Whether every stop-to-stop route takes the same time as with a router built from
+        // scratch for tc. Used to check the incremental updates; it costs a full build.
+        bool MatchesRebuild(const transport_catalogue::TransportCatalogue& tc) const;
+
         std::optional<Route> BuildRoute(std::string_view from, std::string_view to) const;
 
+        std::optional<TravelTimeMatrix> BuildTravelTimeMatrix(const std::vector<std::string_view>& origins,
+                                                              const std::vector<std::string_view>& destinations) const;
+
         const graph::DirectedWeightedGraph<double>& GetGraph() const { return graph_; }
 
     private:
-        graph::VertexId GetWaitVertex(std::string_view stop_name) const;
-        graph::VertexId GetBusVertex(std::string_view stop_name) const;
+        // Every stop has a wait vertex and a bus vertex; boarding is the edge between them.
+        static graph::VertexId GetWaitVertex(domain::StopId stop) { return 2 * static_cast<graph::VertexId>(stop); }
+        static graph::VertexId GetBusVertex(domain::StopId stop) { return GetWaitVertex(stop) + 1; }
 
         RoutingSettings routing_settings_;
         graph::DirectedWeightedGraph<double> graph_;
-        std::unique_ptr<graph::Router<double>> router_;
+        using RouterEngine = std::variant<std::unique_ptr<graph::Router<double>>,
+                                          std::unique_ptr<graph::FlatRouter<double>>,
+                                          std::unique_ptr<graph::DijkstraRouter<double>>,
+                                          std::unique_ptr<graph::ContractionHierarchyRouter<double>>,
+                                          std::unique_ptr<graph::AStarRouter<double>>,
+                                          std::unique_ptr<graph::BidirectionalDijkstraRouter<double>>>;
+
+        RouterEngine CreateRouter() const;
+
+        // Only bidirectional Dijkstra searches backwards over the incoming edges.
+        bool UsesIncomingEdges() const {
+            return routing_settings_.router_mode == RouterMode::BIDIRECTIONAL_DIJKSTRA;
+        }
+
+        void FillGraph(const transport_catalogue::TransportCatalogue& tc);
+
+        // The stops a bus passes in the graph and the road distance from the first one to each.
+        struct RiddenStops {
+            std::vector<domain::StopId> stops;
+            std::vector<double> distances;
+        };
+
+        static RiddenStops GetRiddenStops(const transport_catalogue::TransportCatalogue& tc, domain::BusId bus);
+
+        std::vector<graph::Edge<double>> MakeBusEdges(graph::BusId bus_id, const RiddenStops& ridden) const;
+
+        graph::BusId GetOrAddBusId(std::string_view bus_name);
+
+        static RaptorRouter::Line MakeLine(const RiddenStops& ridden);
+
+        std::vector<graph::EdgeId> AddBusEdges(const transport_catalogue::TransportCatalogue& tc, domain::BusId bus);
+
+        void UpdateRoadToGeoRatio(const transport_catalogue::TransportCatalogue& tc, domain::StopId from,
+                                  domain::StopId to);
+
+        void ApplyGraphChanges(const std::vector<graph::EdgeId>& invalidated_edges,
+                               const std::vector<graph::EdgeId>& relaxing_edges);
+
+        uint64_t ComputeSettingsHash() const;
+
+        bool LoadRoutingTable(const transport_catalogue::TransportCatalogue& tc, uint64_t catalogue_hash);
+
+        void SaveRoutingTable(uint64_t catalogue_hash) const;
+
+        double EstimateRemainingTime(graph::VertexId vertex, graph::VertexId target) const;
+
+        std::unique_ptr<MappedFile> routing_table_mapping_;
+        std::optional<RouterEngine> router_;
+        // Set instead of router_ in RAPTOR mode; the graph then has no bus edges.
+        std::unique_ptr<RaptorRouter> raptor_router_;
 
-        std::unordered_map<std::string, graph::VertexId> stop_wait_vertex_;
-        std::unordered_map<std::string, graph::VertexId> stop_bus_vertex_;
-        std::vector<std::string> vertex_to_stop_name_;
+        // Keyed by views into the catalogue's stop names.
+        std::unordered_map<std::string_view, graph::VertexId> stop_wait_vertex_;
+        std::vector<std::string_view> vertex_to_stop_name_;
+        // Indexed by the bus ids stored in the graph edges. The names are views into the
+        // catalogue; the edge list of a removed bus is empty.
+        std::vector<std::string_view> bus_names_;
+        std::unordered_map<std::string_view, graph::BusId> bus_ids_;
+        std::vector<std::vector<graph::EdgeId>> bus_edges_;
+        std::vector<transport_catalogue::geo::Coordinates> vertex_coordinates_;
+        std::optional<double> road_to_geo_ratio_;
     };
 
 }